@@ -0,0 +1,445 @@
+//lang::Cpp
+
+#pragma once
+
+#include "object.h"
+#include <stdint.h>
+#include <float.h>
+#include <limits.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AGGREGATE_X86 1
+#include <immintrin.h>
+// The fastest version of a kernel that this CPU supports
+#define PICK_KERNEL(name) \
+    (level() == 2 ? name##_avx2 : level() == 1 ? name##_sse2 : name##_scalar)
+#else
+#define PICK_KERNEL(name) name##_scalar
+#endif
+
+/*************************************************************************
+ * ColumnStats::
+ * Summary of a run of numeric values: count, sum, min, max, and the sum of
+ * squared deviations from the mean (m2), from which the mean and variance
+ * follow. Summaries of disjoint runs are combined with merge(), so runs can
+ * be summarized in parallel.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ColumnStats : public Object {
+    public:
+        size_t count_;
+        double sum_;
+        double min_;
+        double max_;
+        double m2_;
+
+        /** Summary of no values. */
+        ColumnStats() {
+            count_ = 0;
+            sum_ = 0;
+            min_ = 0;
+            max_ = 0;
+            m2_ = 0;
+        }
+
+        /** Number of values. */
+        size_t count() { return count_; }
+
+        /** Sum of the values. */
+        double sum() { return sum_; }
+
+        /** Smallest and largest value, 0 if there are none. */
+        double min() { return min_; }
+        double max() { return max_; }
+
+        /** Mean of the values, 0 if there are none. */
+        double mean() { return count_ == 0 ? 0 : sum_ / count_; }
+
+        /** Population variance of the values, 0 if there are none. */
+        double variance() { return count_ == 0 ? 0 : m2_ / count_; }
+
+        /** Folds the summary of another, disjoint run of values into this one
+         *  (Chan et al.'s pairwise update for m2). */
+        void merge(ColumnStats* other) {
+            if (other->count_ == 0) return;
+            if (count_ == 0) {
+                count_ = other->count_;
+                sum_ = other->sum_;
+                min_ = other->min_;
+                max_ = other->max_;
+                m2_ = other->m2_;
+                return;
+            }
+            double n = (double)count_ + other->count_;
+            double delta = other->mean() - mean();
+            m2_ += other->m2_ + delta * delta * ((double)count_ * other->count_ / n);
+            count_ += other->count_;
+            sum_ += other->sum_;
+            if (other->min_ < min_) min_ = other->min_;
+            if (other->max_ > max_) max_ = other->max_;
+        }
+};
+
+/** Signatures of the kernels. A summary kernel reads n > 0 values and writes
+ *  their sum, min and max; an m2 kernel returns the sum of (value - mean)^2. */
+typedef void (*IntSummaryKernel)(const int* vals, size_t n, long* sum, int* min, int* max);
+typedef double (*IntM2Kernel)(const int* vals, size_t n, double mean);
+typedef void (*FloatSummaryKernel)(const float* vals, size_t n, double* sum, float* min, float* max);
+typedef double (*FloatM2Kernel)(const float* vals, size_t n, double mean);
+
+/*************************************************************************
+ * Kernels::
+ * Reductions over contiguous arrays of ints and floats. Each kernel has a
+ * scalar version and, on x86, SSE2 and AVX2 versions; the fastest one the
+ * CPU supports is picked the first time a kernel is used. This class has no
+ * data, it only groups the functions.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Kernels {
+    public:
+        static void int_summary_scalar(const int* vals, size_t n, long* sum, int* min, int* max) {
+            long s = 0;
+            int lo = vals[0];
+            int hi = vals[0];
+            for (size_t i = 0; i < n; i++) {
+                s += vals[i];
+                if (vals[i] < lo) lo = vals[i];
+                if (vals[i] > hi) hi = vals[i];
+            }
+            *sum = s;
+            *min = lo;
+            *max = hi;
+        }
+
+        static double int_m2_scalar(const int* vals, size_t n, double mean) {
+            double m2 = 0;
+            for (size_t i = 0; i < n; i++) {
+                double d = vals[i] - mean;
+                m2 += d * d;
+            }
+            return m2;
+        }
+
+        static void float_summary_scalar(const float* vals, size_t n, double* sum, float* min,
+                                         float* max) {
+            double s = 0;
+            float lo = vals[0];
+            float hi = vals[0];
+            for (size_t i = 0; i < n; i++) {
+                s += vals[i];
+                if (vals[i] < lo) lo = vals[i];
+                if (vals[i] > hi) hi = vals[i];
+            }
+            *sum = s;
+            *min = lo;
+            *max = hi;
+        }
+
+        static double float_m2_scalar(const float* vals, size_t n, double mean) {
+            double m2 = 0;
+            for (size_t i = 0; i < n; i++) {
+                double d = vals[i] - mean;
+                m2 += d * d;
+            }
+            return m2;
+        }
+
+#ifdef AGGREGATE_X86
+        // SSE2 has no 32-bit min/max or sign extension, so they are built from
+        // compares and shifts.
+        __attribute__((target("sse2")))
+        static void int_summary_sse2(const int* vals, size_t n, long* sum, int* min, int* max) {
+            __m128i acc = _mm_setzero_si128();
+            __m128i lo = _mm_set1_epi32(vals[0]);
+            __m128i hi = lo;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(vals + i));
+                __m128i sign = _mm_srai_epi32(v, 31);
+                acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+                acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+                __m128i gt = _mm_cmpgt_epi32(lo, v);
+                lo = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, lo));
+                gt = _mm_cmpgt_epi32(v, hi);
+                hi = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, hi));
+            }
+            int64_t sums[2];
+            int los[4], his[4];
+            _mm_storeu_si128((__m128i*)sums, acc);
+            _mm_storeu_si128((__m128i*)los, lo);
+            _mm_storeu_si128((__m128i*)his, hi);
+            long s = sums[0] + sums[1];
+            int l = los[0], h = his[0];
+            for (size_t j = 1; j < 4; j++) {
+                if (los[j] < l) l = los[j];
+                if (his[j] > h) h = his[j];
+            }
+            for (; i < n; i++) {
+                s += vals[i];
+                if (vals[i] < l) l = vals[i];
+                if (vals[i] > h) h = vals[i];
+            }
+            *sum = s;
+            *min = l;
+            *max = h;
+        }
+
+        __attribute__((target("sse2")))
+        static double int_m2_sse2(const int* vals, size_t n, double mean) {
+            __m128d m = _mm_set1_pd(mean);
+            __m128d acc = _mm_setzero_pd();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(vals + i));
+                __m128d d = _mm_sub_pd(_mm_cvtepi32_pd(v), m);
+                acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+                d = _mm_sub_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, 0x0E)), m);
+                acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+            }
+            double parts[2];
+            _mm_storeu_pd(parts, acc);
+            double m2 = parts[0] + parts[1];
+            for (; i < n; i++) {
+                double d = vals[i] - mean;
+                m2 += d * d;
+            }
+            return m2;
+        }
+
+        __attribute__((target("sse2")))
+        static void float_summary_sse2(const float* vals, size_t n, double* sum, float* min,
+                                       float* max) {
+            __m128d acc = _mm_setzero_pd();
+            __m128 lo = _mm_set1_ps(vals[0]);
+            __m128 hi = lo;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128 v = _mm_loadu_ps(vals + i);
+                acc = _mm_add_pd(acc, _mm_cvtps_pd(v));
+                acc = _mm_add_pd(acc, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+                lo = _mm_min_ps(lo, v);
+                hi = _mm_max_ps(hi, v);
+            }
+            double sums[2];
+            float los[4], his[4];
+            _mm_storeu_pd(sums, acc);
+            _mm_storeu_ps(los, lo);
+            _mm_storeu_ps(his, hi);
+            double s = sums[0] + sums[1];
+            float l = los[0], h = his[0];
+            for (size_t j = 1; j < 4; j++) {
+                if (los[j] < l) l = los[j];
+                if (his[j] > h) h = his[j];
+            }
+            for (; i < n; i++) {
+                s += vals[i];
+                if (vals[i] < l) l = vals[i];
+                if (vals[i] > h) h = vals[i];
+            }
+            *sum = s;
+            *min = l;
+            *max = h;
+        }
+
+        __attribute__((target("sse2")))
+        static double float_m2_sse2(const float* vals, size_t n, double mean) {
+            __m128d m = _mm_set1_pd(mean);
+            __m128d acc = _mm_setzero_pd();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128 v = _mm_loadu_ps(vals + i);
+                __m128d d = _mm_sub_pd(_mm_cvtps_pd(v), m);
+                acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+                d = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), m);
+                acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+            }
+            double parts[2];
+            _mm_storeu_pd(parts, acc);
+            double m2 = parts[0] + parts[1];
+            for (; i < n; i++) {
+                double d = vals[i] - mean;
+                m2 += d * d;
+            }
+            return m2;
+        }
+
+        __attribute__((target("avx2")))
+        static void int_summary_avx2(const int* vals, size_t n, long* sum, int* min, int* max) {
+            __m256i acc = _mm256_setzero_si256();
+            __m256i lo = _mm256_set1_epi32(vals[0]);
+            __m256i hi = lo;
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256i v = _mm256_loadu_si256((const __m256i*)(vals + i));
+                acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+                acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+                lo = _mm256_min_epi32(lo, v);
+                hi = _mm256_max_epi32(hi, v);
+            }
+            int64_t sums[4];
+            int los[8], his[8];
+            _mm256_storeu_si256((__m256i*)sums, acc);
+            _mm256_storeu_si256((__m256i*)los, lo);
+            _mm256_storeu_si256((__m256i*)his, hi);
+            long s = sums[0] + sums[1] + sums[2] + sums[3];
+            int l = los[0], h = his[0];
+            for (size_t j = 1; j < 8; j++) {
+                if (los[j] < l) l = los[j];
+                if (his[j] > h) h = his[j];
+            }
+            for (; i < n; i++) {
+                s += vals[i];
+                if (vals[i] < l) l = vals[i];
+                if (vals[i] > h) h = vals[i];
+            }
+            *sum = s;
+            *min = l;
+            *max = h;
+        }
+
+        __attribute__((target("avx2")))
+        static double int_m2_avx2(const int* vals, size_t n, double mean) {
+            __m256d m = _mm256_set1_pd(mean);
+            __m256d acc = _mm256_setzero_pd();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i*)(vals + i));
+                __m256d d = _mm256_sub_pd(_mm256_cvtepi32_pd(v), m);
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+            }
+            double parts[4];
+            _mm256_storeu_pd(parts, acc);
+            double m2 = parts[0] + parts[1] + parts[2] + parts[3];
+            for (; i < n; i++) {
+                double d = vals[i] - mean;
+                m2 += d * d;
+            }
+            return m2;
+        }
+
+        __attribute__((target("avx2")))
+        static void float_summary_avx2(const float* vals, size_t n, double* sum, float* min,
+                                       float* max) {
+            __m256d acc = _mm256_setzero_pd();
+            __m256 lo = _mm256_set1_ps(vals[0]);
+            __m256 hi = lo;
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256 v = _mm256_loadu_ps(vals + i);
+                acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+                acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+                lo = _mm256_min_ps(lo, v);
+                hi = _mm256_max_ps(hi, v);
+            }
+            double sums[4];
+            float los[8], his[8];
+            _mm256_storeu_pd(sums, acc);
+            _mm256_storeu_ps(los, lo);
+            _mm256_storeu_ps(his, hi);
+            double s = sums[0] + sums[1] + sums[2] + sums[3];
+            float l = los[0], h = his[0];
+            for (size_t j = 1; j < 8; j++) {
+                if (los[j] < l) l = los[j];
+                if (his[j] > h) h = his[j];
+            }
+            for (; i < n; i++) {
+                s += vals[i];
+                if (vals[i] < l) l = vals[i];
+                if (vals[i] > h) h = vals[i];
+            }
+            *sum = s;
+            *min = l;
+            *max = h;
+        }
+
+        __attribute__((target("avx2")))
+        static double float_m2_avx2(const float* vals, size_t n, double mean) {
+            __m256d m = _mm256_set1_pd(mean);
+            __m256d acc = _mm256_setzero_pd();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m256d d = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(vals + i)), m);
+                acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+            }
+            double parts[4];
+            _mm256_storeu_pd(parts, acc);
+            double m2 = parts[0] + parts[1] + parts[2] + parts[3];
+            for (; i < n; i++) {
+                double d = vals[i] - mean;
+                m2 += d * d;
+            }
+            return m2;
+        }
+#endif
+
+        /** The instruction set the kernels use: 2 for AVX2, 1 for SSE2, 0 for
+         *  plain scalar code. Detected once. */
+        static int level() {
+            static int level = detect_level();
+            return level;
+        }
+
+        static int detect_level() {
+#ifdef AGGREGATE_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return 2;
+            if (__builtin_cpu_supports("sse2")) return 1;
+#endif
+            return 0;
+        }
+
+        /** Sum, min and max of n > 0 ints. */
+        static void int_summary(const int* vals, size_t n, long* sum, int* min, int* max) {
+            static IntSummaryKernel kernel = PICK_KERNEL(int_summary);
+            kernel(vals, n, sum, min, max);
+        }
+
+        /** Sum of squared deviations of n ints from mean. */
+        static double int_m2(const int* vals, size_t n, double mean) {
+            static IntM2Kernel kernel = PICK_KERNEL(int_m2);
+            return kernel(vals, n, mean);
+        }
+
+        /** Sum, min and max of n > 0 floats. The sum is accumulated in double. */
+        static void float_summary(const float* vals, size_t n, double* sum, float* min,
+                                  float* max) {
+            static FloatSummaryKernel kernel = PICK_KERNEL(float_summary);
+            kernel(vals, n, sum, min, max);
+        }
+
+        /** Sum of squared deviations of n floats from mean. */
+        static double float_m2(const float* vals, size_t n, double mean) {
+            static FloatM2Kernel kernel = PICK_KERNEL(float_m2);
+            return kernel(vals, n, mean);
+        }
+
+        /** Summarizes n ints into stats. */
+        static void int_stats(const int* vals, size_t n, ColumnStats* stats) {
+            if (n == 0) return;
+            long sum;
+            int min, max;
+            int_summary(vals, n, &sum, &min, &max);
+            stats->count_ = n;
+            stats->sum_ = sum;
+            stats->min_ = min;
+            stats->max_ = max;
+            stats->m2_ = int_m2(vals, n, (double)sum / n);
+        }
+
+        /** Summarizes n floats into stats. */
+        static void float_stats(const float* vals, size_t n, ColumnStats* stats) {
+            if (n == 0) return;
+            double sum;
+            float min, max;
+            float_summary(vals, n, &sum, &min, &max);
+            stats->count_ = n;
+            stats->sum_ = sum;
+            stats->min_ = min;
+            stats->max_ = max;
+            stats->m2_ = float_m2(vals, n, sum / n);
+        }
+};
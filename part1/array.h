@@ -3,76 +3,338 @@
 #include "string.h"
 #include <stdbool.h>
 #include <assert.h>
+#include <stdint.h>
 
+// Every chunk but the last holds exactly ARRAY_CHUNK_SIZE elements, so an index
+// splits into a chunk number and an offset with a shift and a mask.
+#define ARRAY_CHUNK_SHIFT 16
+#define ARRAY_CHUNK_SIZE ((size_t)1 << ARRAY_CHUNK_SHIFT)
+#define ARRAY_CHUNK_MASK (ARRAY_CHUNK_SIZE - 1)
+// Capacity of the first chunk of a new array; it doubles up to ARRAY_CHUNK_SIZE
+#define INITIAL_CHUNK_CAPACITY 8
+// Initial number of slots in the table of chunks; it doubles when full
 #define INITIAL_OUTER_CAPACITY 16
-#define INNER_CAPACITY 8
 
 /**
- * Represents an array (Java: List) of objects.
- * In order to have constant time lookup and avoid copying the payload of the array,
- * this data structure is an array of array pointers, essentially a 2D array.
- * The inner arrays have a fixed length and when the outer array runs out of space,
- * a new array is allocated and the inner array pointers are transferred to it.
+ * Storage shared by the typed arrays below. Elements live in a table of chunks.
+ * The first chunk starts small and doubles until it reaches ARRAY_CHUNK_SIZE
+ * elements, after which every new chunk is allocated at full size and never
+ * moves again. Lookup is a shift and a mask, appending 100M elements costs
+ * about 1.5K allocations, and the chunk table itself only grows by doubling.
  * 
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  */
-class Array : public Object {
+class ChunkedStorage : public Object {
     public:
-        Object*** objects_;   
-        int size_;
-        // Number of inner arrays that we have space for
-        int outer_capacity_; 
-        // Number of inner arrays that have been initialized
-        int array_count_;
-    
+        char** chunks_;
+        size_t elem_size_;
+        size_t size_;
+        // Number of chunks that have been allocated
+        size_t chunk_count_;
+        // Number of chunks that the chunk table has space for
+        size_t outer_capacity_;
+        // Number of elements that the allocated chunks can hold
+        size_t capacity_;
+        // Number of leading chunks that point into memory owned by someone
+        // else (see borrow) and must not be freed
+        size_t borrowed_;
+
         /**
-         * Initialize an empty Array.
+         * Initialize empty storage for elements of the given size in bytes.
          */
-        Array() {
+        ChunkedStorage(size_t elem_size) {
+            elem_size_ = elem_size;
             size_ = 0;
             outer_capacity_ = INITIAL_OUTER_CAPACITY;
-            array_count_ = 1;
-            objects_ = new Object**[outer_capacity_];
-            objects_[0] = new Object*[INNER_CAPACITY];
+            chunks_ = new char*[outer_capacity_];
+            chunks_[0] = new char[INITIAL_CHUNK_CAPACITY * elem_size_];
+            chunk_count_ = 1;
+            capacity_ = INITIAL_CHUNK_CAPACITY;
+            borrowed_ = 0;
+        }
+
+        /**
+         * Destructor, frees every chunk that isn't borrowed.
+         */
+        ~ChunkedStorage() {
+            for (size_t i = borrowed_; i < chunk_count_; i++) {
+                delete[] chunks_[i];
+            }
+            delete[] chunks_;
+        }
+
+        /**
+         * Private function that resizes the last chunk, which must be the only
+         * chunk, to hold the given number of elements.
+         */
+        void resize_first_chunk_(size_t capacity) {
+            assert(chunk_count_ == 1);
+            char* chunk = new char[capacity * elem_size_];
+            memcpy(chunk, chunks_[0], size_ * elem_size_);
+            delete[] chunks_[0];
+            chunks_[0] = chunk;
+            capacity_ = capacity;
+        }
+
+        /**
+         * Private function that makes room for one more slot in the chunk
+         * table, doubling the table if it is full.
+         */
+        void grow_table_() {
+            if (chunk_count_ == outer_capacity_) {
+                char** new_outer_arr = new char*[outer_capacity_ * 2];
+                memcpy(new_outer_arr, chunks_, chunk_count_ * sizeof(char*));
+                delete[] chunks_;
+                chunks_ = new_outer_arr;
+                outer_capacity_ *= 2;
+            }
         }
 
         /**
-         * Destructor for a Array
+         * Private function that adds a full-size chunk at the end of the table.
          */
-        ~Array() {
-            delete[] objects_;
+        void add_chunk_() {
+            grow_table_();
+            chunks_[chunk_count_++] = new char[ARRAY_CHUNK_SIZE * elem_size_];
+            capacity_ += ARRAY_CHUNK_SIZE;
         }
 
         /**
-         * Private function that reallocates more space for the array
-         * once it fills up.
+         * Private function that makes room for at least one more element.
          */
-        void reallocate_() {
-            Object*** new_outer_arr = new Object**[outer_capacity_ + INITIAL_OUTER_CAPACITY];
+        void grow_() {
+            if (capacity_ < ARRAY_CHUNK_SIZE) {
+                resize_first_chunk_(capacity_ * 2);
+            } else {
+                add_chunk_();
+            }
+        }
+
+        // Makes sure that n elements fit without any further allocation.
+        void reserve(size_t n) {
+            if (n <= capacity_) return;
+            if (capacity_ < ARRAY_CHUNK_SIZE) {
+                size_t capacity = capacity_;
+                while (capacity < n && capacity < ARRAY_CHUNK_SIZE) capacity *= 2;
+                resize_first_chunk_(capacity);
+            }
+            while (capacity_ < n) add_chunk_();
+        }
+
+        // Grows the storage to n elements, which must be at least size(). The
+        // new elements are uninitialized, to be written through the chunks.
+        void resize(size_t n) {
+            assert(n >= size_);
+            reserve(n);
+            size_ = n;
+        }
 
-            Object*** old_outer_arr = objects_;
-            for (int i = 0; i < array_count_; i++) {
-                new_outer_arr[i] = old_outer_arr[i];
+        // Appends the n elements stored contiguously at data, copying them a
+        // chunk at a time.
+        void append_data(const char* data, size_t n) {
+            reserve(size_ + n);
+            while (n > 0) {
+                size_t room = ARRAY_CHUNK_SIZE - (size_ & ARRAY_CHUNK_MASK);
+                size_t count = n < room ? n : room;
+                memcpy(chunks_[size_ >> ARRAY_CHUNK_SHIFT] + (size_ & ARRAY_CHUNK_MASK) * elem_size_,
+                       data, count * elem_size_);
+                size_ += count;
+                data += count * elem_size_;
+                n -= count;
             }
-            delete[] old_outer_arr;
-            objects_ = new_outer_arr;
+        }
+
+        // Appends n elements whose bytes are all zero, a chunk at a time.
+        void append_zeros(size_t n) {
+            reserve(size_ + n);
+            while (n > 0) {
+                size_t room = ARRAY_CHUNK_SIZE - (size_ & ARRAY_CHUNK_MASK);
+                size_t count = n < room ? n : room;
+                memset(chunks_[size_ >> ARRAY_CHUNK_SHIFT] + (size_ & ARRAY_CHUNK_MASK) * elem_size_,
+                       0, count * elem_size_);
+                size_ += count;
+                n -= count;
+            }
+        }
+
+        // Appends a copy of every element of other, which must hold elements
+        // of the same size, a chunk at a time.
+        void append_storage(ChunkedStorage* other) {
+            assert(elem_size_ == other->elem_size_);
+            size_t n = other->size_;
+            reserve(size_ + n);
+            for (size_t k = 0; (k << ARRAY_CHUNK_SHIFT) < n; k++) {
+                size_t start = k << ARRAY_CHUNK_SHIFT;
+                size_t length = n - start < ARRAY_CHUNK_SIZE ? n - start : ARRAY_CHUNK_SIZE;
+                append_data(other->chunks_[k], length);
+            }
+        }
+
+        /**
+         * Private function that drops every chunk and goes back to the state
+         * of a newly constructed storage.
+         */
+        void reset_() {
+            for (size_t i = borrowed_; i < chunk_count_; i++) {
+                delete[] chunks_[i];
+            }
+            delete[] chunks_;
+            size_ = 0;
+            borrowed_ = 0;
+            outer_capacity_ = INITIAL_OUTER_CAPACITY;
+            chunks_ = new char*[outer_capacity_];
+            chunks_[0] = new char[INITIAL_CHUNK_CAPACITY * elem_size_];
+            chunk_count_ = 1;
+            capacity_ = INITIAL_CHUNK_CAPACITY;
+        }
+
+        // Moves every element of other (which must hold elements of the same
+        // size) onto the end of this storage and leaves other empty. When this
+        // storage is empty or ends exactly on a full chunk, other's chunks are
+        // handed over without copying the elements; otherwise they are copied.
+        void take_chunks(ChunkedStorage* other) {
+            assert(elem_size_ == other->elem_size_);
+            if (other->size_ == 0) return;
+            if (size_ == 0) {
+                // Swap the chunk tables so that other frees our empty chunk
+                char** chunks = chunks_;
+                size_t chunk_count = chunk_count_;
+                size_t outer_capacity = outer_capacity_;
+                size_t borrowed = borrowed_;
+                chunks_ = other->chunks_;
+                size_ = other->size_;
+                chunk_count_ = other->chunk_count_;
+                outer_capacity_ = other->outer_capacity_;
+                capacity_ = other->capacity_;
+                borrowed_ = other->borrowed_;
+                other->chunks_ = chunks;
+                other->chunk_count_ = chunk_count;
+                other->outer_capacity_ = outer_capacity;
+                other->borrowed_ = borrowed;
+                other->reset_();
+                return;
+            }
+            // Borrowed chunks have to stay in front of the owned ones
+            if (size_ == capacity_ && capacity_ >= ARRAY_CHUNK_SIZE && other->borrowed_ == 0) {
+                for (size_t k = 0; k < other->chunk_count_; k++) {
+                    size_t length = other->chunk_length(k);
+                    if (length == 0) break;
+                    if (k == 0 && other->capacity_ < ARRAY_CHUNK_SIZE) {
+                        // A first chunk that never reached full size can't sit
+                        // in the middle of the table, so give it a full chunk
+                        add_chunk_();
+                        memcpy(chunks_[chunk_count_ - 1], other->chunks_[0], length * elem_size_);
+                    } else {
+                        grow_table_();
+                        chunks_[chunk_count_++] = other->chunks_[k];
+                        other->chunks_[k] = nullptr;
+                        capacity_ += ARRAY_CHUNK_SIZE;
+                    }
+                    size_ += length;
+                }
+                other->reset_();
+                return;
+            }
+            reserve(size_ + other->size_);
+            for (size_t i = 0; i < other->size_; ) {
+                // Copy the longest run that stays within one chunk on both sides
+                size_t src = other->chunk_length(i >> ARRAY_CHUNK_SHIFT) - (i & ARRAY_CHUNK_MASK);
+                size_t dst = ARRAY_CHUNK_SIZE - (size_ & ARRAY_CHUNK_MASK);
+                size_t n = src < dst ? src : dst;
+                memcpy(chunks_[size_ >> ARRAY_CHUNK_SHIFT] + (size_ & ARRAY_CHUNK_MASK) * elem_size_,
+                       other->chunks_[i >> ARRAY_CHUNK_SHIFT] + (i & ARRAY_CHUNK_MASK) * elem_size_,
+                       n * elem_size_);
+                size_ += n;
+                i += n;
+            }
+            other->reset_();
+        }
+
+        // Fills this storage, which must be empty, with the n elements stored
+        // contiguously at data. Every full chunk of data is used in place and
+        // never freed, so data must outlive this storage; the partial chunk at
+        // the end, if any, is copied. Elements can still be set and appended
+        // afterwards, which writes to data.
+        void borrow(char* data, size_t n) {
+            assert(size_ == 0 && borrowed_ == 0);
+            size_t full = n >> ARRAY_CHUNK_SHIFT;
+            if (full == 0) {
+                reserve(n);
+                memcpy(chunks_[0], data, n * elem_size_);
+                size_ = n;
+                return;
+            }
+            for (size_t i = 0; i < chunk_count_; i++) {
+                delete[] chunks_[i];
+            }
+            delete[] chunks_;
+            outer_capacity_ = full + INITIAL_OUTER_CAPACITY;
+            chunks_ = new char*[outer_capacity_];
+            for (size_t k = 0; k < full; k++) {
+                chunks_[k] = data + (k << ARRAY_CHUNK_SHIFT) * elem_size_;
+            }
+            chunk_count_ = full;
+            borrowed_ = full;
+            capacity_ = full << ARRAY_CHUNK_SHIFT;
+            size_ = capacity_;
+            if (n > size_) {
+                add_chunk_();
+                memcpy(chunks_[full], data + size_ * elem_size_, (n - size_) * elem_size_);
+                size_ = n;
+            }
+        }
+
+        // Returns the number of elements.
+        size_t size() {
+            return size_;
+        }
+
+        // Returns the number of bytes allocated for elements, including room
+        // for elements not added yet and borrowed chunks.
+        size_t footprint() {
+            return capacity_ * elem_size_;
+        }
+
+        // Returns the number of allocated chunks. Chunk k holds the elements
+        // starting at index k * ARRAY_CHUNK_SIZE.
+        size_t chunk_count() {
+            return chunk_count_;
+        }
+
+        // Returns the number of elements stored in chunk k.
+        size_t chunk_length(size_t k) {
+            size_t start = k << ARRAY_CHUNK_SHIFT;
+            if (start >= size_) return 0;
+            return size_ - start < ARRAY_CHUNK_SIZE ? size_ - start : ARRAY_CHUNK_SIZE;
+        }
+};
+
+/**
+ * Represents an array (Java: List) of objects.
+ * In order to have constant time lookup and avoid copying the payload of the array,
+ * the elements are kept in chunks that never move once they are full
+ * (see ChunkedStorage).
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Array : public ChunkedStorage {
+    public:
+        /**
+         * Initialize an empty Array.
+         */
+        Array() : ChunkedStorage(sizeof(Object*)) { }
 
-            outer_capacity_ += INITIAL_OUTER_CAPACITY;
+        // Returns the chunk k as an array of objects.
+        Object** chunk(size_t k) {
+            return reinterpret_cast<Object**>(chunks_[k]);
         }
         
         // Appends val to the end of the array.
         void append(Object* val) {
-            // If all of the inner arrays are full, allocate more memory for the outer one.
-            if (size_ + 1 > outer_capacity_ * INNER_CAPACITY) reallocate_();
-            // If the last inner array is full, create a new one and add val to it.
-            if (size_ + 1 > array_count_ * INNER_CAPACITY) {
-                objects_[array_count_] = new Object*[INNER_CAPACITY];
-                objects_[array_count_][0] = val;
-                array_count_++;
-            } else {
-                objects_[array_count_ - 1][size_ % INNER_CAPACITY] = val;
-            }
+            if (size_ == capacity_) grow_();
+            chunk(size_ >> ARRAY_CHUNK_SHIFT)[size_ & ARRAY_CHUNK_MASK] = val;
             size_++;
         }
         
@@ -80,7 +342,8 @@ class Array : public Object {
         // If vals is null, does nothing.
         void append_all(Array* vals) {
             if (vals == NULL) return;
-            for (int i = 0; i < vals->size(); i++) {
+            reserve(size_ + vals->size());
+            for (size_t i = 0; i < vals->size(); i++) {
                 Object* val = vals->get(i);
                 if (val == nullptr) {
                     append(nullptr);
@@ -93,7 +356,6 @@ class Array : public Object {
         // Sets the element at index to val.
         // If index == size(), appends to the end of the array.
         void set(Object* val, size_t index) {
-            assert(index >= 0);
             assert(index <= size_);
 
             if (index == size_) {
@@ -101,80 +363,51 @@ class Array : public Object {
                 return;
             }
 
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            objects_[outer_idx][inner_idx] = val;
+            chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK] = val;
         }
         
         // Gets the element at the given index.
         Object* get(size_t index) {
-            assert(index >= 0);
             assert(index < size_);
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            return objects_[outer_idx][inner_idx];
+            return chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK];
         }
         
         // Returns if this array contains obj, using obj->equals().
         // If obj is null, uses == .
         bool contains(Object* obj) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    int inner_idx = j % INNER_CAPACITY;
-                    if (obj == NULL || objects_[i][inner_idx] == NULL) {
-                        if (objects_[i][inner_idx] == obj) return true;
-                    } else {
-                        if (objects_[i][inner_idx]->equals(obj)) return true;
-                    }
-                    count++;
-                }
-            }
-            return false;
+            return index_of(obj) < size_;
         }
         
         // Returns the first index of obj, using obj->equals().
         // If obj is null, uses == .
         // If obj does not exist in the array, returns -1.
         size_t index_of(Object* obj) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    int inner_idx = j % INNER_CAPACITY;
-                    if (obj == NULL || objects_[i][inner_idx] == NULL) {
-                        if (objects_[i][inner_idx] == obj) return count;
-                    } else {
-                        if (objects_[i][inner_idx]->equals(obj)) return count;
-                    }
-                    count++;
-                } 
+            for (size_t i = 0; i < size_; i++) {
+                Object* elem = get(i);
+                if (obj == NULL || elem == NULL) {
+                    if (elem == obj) return i;
+                } else {
+                    if (elem->equals(obj)) return i;
+                }
             }
             return -1;
         }
-        
-        // Returns the number of elements in this array. 
-        size_t size() {
-            return size_;
-        }
 
         // Inherited from Object
         // Is this Array equal to the given Object?
         bool equals(Object* o) {
             Array* other = dynamic_cast<Array*>(o);
             if (other == nullptr) return false;
-            if (size_ == 0) return other->size() == 0;
+            if (size_ != other->size()) return false;
 
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    int inner_idx = j % INNER_CAPACITY;
-                    if (!(objects_[i][inner_idx] == NULL && other->get(count) == NULL)) return false;
-                    if (!objects_[i][inner_idx]->equals(other->get(count))) return false;
-                    count++;
-                } 
+            for (size_t i = 0; i < size_; i++) {
+                Object* elem = get(i);
+                Object* other_elem = other->get(i);
+                if (elem == NULL || other_elem == NULL) {
+                    if (elem != other_elem) return false;
+                } else if (!elem->equals(other_elem)) {
+                    return false;
+                }
             }
 
             return true;
@@ -183,138 +416,215 @@ class Array : public Object {
 
 /**
  * Represents an array (Java: List) of booleans.
- * In order to have constant time lookup and avoid copying the payload of the array,
- * this data structure is an array of array pointers, essentially a 2D array.
- * The inner arrays have a fixed length and when the outer array runs out of space,
- * a new array is allocated and the inner array pointers are transferred to it.
+ * The booleans are packed 64 to a 64-bit word, and the words are kept in
+ * chunks that never move once they are full (see ChunkedStorage). Bits past
+ * the last boolean are always zero, so whole words can be counted and combined
+ * without masking.
  * 
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  */
-class BoolArray : public Object {
+class BoolArray : public ChunkedStorage {
     public:
-        bool** bools_;
-        int size_;
-        // Number of inner arrays that we have space for
-        int outer_capacity_; 
-        // Number of inner arrays that have been initialized
-        int array_count_;
+        // Number of booleans; the storage's size_ counts words
+        size_t nbits_;
 
         /**
          * Constructor for a BoolArray.
          * 
         */ 
-        BoolArray() {
-            size_ = 0;
-            outer_capacity_ = INITIAL_OUTER_CAPACITY;
-            array_count_ = 1;
-            bools_ = new bool*[outer_capacity_];
-            bools_[0] = new bool[INNER_CAPACITY];
-        } 
+        BoolArray() : ChunkedStorage(sizeof(uint64_t)) {
+            nbits_ = 0;
+        }
 
-        /**
-         * Destructor for a BoolArray.
-         */ 
-        ~BoolArray() {
-            delete[] bools_;
+        // Returns the chunk k as an array of words.
+        uint64_t* chunk(size_t k) {
+            return reinterpret_cast<uint64_t*>(chunks_[k]);
         }
 
-        /*
-         * Private function that reallocates more space for the array
-         * once it fills up.
-         */
-        void reallocate_() {
-            bool** new_outer_arr = new bool*[outer_capacity_ + INITIAL_OUTER_CAPACITY];
+        // Returns the number of words holding the booleans.
+        size_t word_count() {
+            return size_;
+        }
 
-            bool** old_outer_arr = bools_;
-            for (int i = 0; i < array_count_; i++) {
-                new_outer_arr[i] = old_outer_arr[i];
-            }
-            delete[] old_outer_arr;
-            bools_ = new_outer_arr;
+        // Returns the word holding booleans [64 * w, 64 * w + 64).
+        uint64_t get_word(size_t w) {
+            assert(w < size_);
+            return chunk(w >> ARRAY_CHUNK_SHIFT)[w & ARRAY_CHUNK_MASK];
+        }
 
-            outer_capacity_ += INITIAL_OUTER_CAPACITY;
+        // Overwrites word w. Bits past size() must be zero.
+        void set_word(size_t w, uint64_t word) {
+            assert(w < size_);
+            chunk(w >> ARRAY_CHUNK_SHIFT)[w & ARRAY_CHUNK_MASK] = word;
+        }
+
+        // Appends a whole word to the end of the array, size() must be a
+        // multiple of 64.
+        void append_word(uint64_t word, size_t nbits) {
+            assert(nbits_ % 64 == 0 && nbits <= 64);
+            if (size_ == capacity_) grow_();
+            chunk(size_ >> ARRAY_CHUNK_SHIFT)[size_ & ARRAY_CHUNK_MASK] = word;
+            size_++;
+            nbits_ += nbits;
+        }
+
+        // Makes sure that n booleans fit without any further allocation.
+        void reserve(size_t n) {
+            ChunkedStorage::reserve((n + 63) / 64);
+        }
+
+        // Grows the array, whose size() must be a multiple of 64, to n
+        // booleans. The new words are uninitialized, to be written whole with
+        // set_word, which lets several threads fill separate words at once.
+        void resize_bits(size_t n) {
+            assert(nbits_ % 64 == 0 && n >= nbits_);
+            resize((n + 63) / 64);
+            nbits_ = n;
+        }
+
+        // Fills this array, which must be empty, with the nbits booleans
+        // packed into words (see ChunkedStorage::borrow). Bits past nbits in
+        // the last word are cleared.
+        void borrow_words(uint64_t* words, size_t nbits) {
+            borrow(reinterpret_cast<char*>(words), (nbits + 63) / 64);
+            nbits_ = nbits;
+            if (nbits % 64 != 0) {
+                size_t last = nbits / 64;
+                set_word(last, get_word(last) & (((uint64_t)1 << (nbits % 64)) - 1));
+            }
         }
     
         // Appends val onto the end of the array
         void append(bool val) {
-            // If all of the inner arrays are full, allocate more memory for the outer one.
-            if (size_ + 1 > outer_capacity_ * INNER_CAPACITY) reallocate_();
-            // If the last inner array is full, create a new one and add val to it.
-            if (size_ + 1 > array_count_ * INNER_CAPACITY) {
-                bools_[array_count_] = new bool[INNER_CAPACITY];
-                bools_[array_count_][0] = val;
-                array_count_++;
-            } else {
-                bools_[array_count_ - 1][size_ % INNER_CAPACITY] = val;
+            if (nbits_ % 64 == 0) {
+                append_word(val ? 1 : 0, 1);
+                return;
             }
-            size_++;
+            if (val) set_word(nbits_ / 64, get_word(nbits_ / 64) | ((uint64_t)1 << (nbits_ % 64)));
+            nbits_++;
         }
         
         // Appends every element of vals to the end of the array.
         // If vals is null, does nothing.
         void append_all(BoolArray* vals) {
             if (vals == NULL) return;
-            for (int i = 0; i < vals->size(); i++) {
+            reserve(nbits_ + vals->size());
+            if (nbits_ % 64 == 0) {
+                size_t remaining = vals->size();
+                for (size_t w = 0; w < vals->word_count(); w++) {
+                    size_t nbits = remaining < 64 ? remaining : 64;
+                    append_word(vals->get_word(w), nbits);
+                    remaining -= nbits;
+                }
+                return;
+            }
+            for (size_t i = 0; i < vals->size(); i++) {
                 append(vals->get(i));
             }
         }
+
+        // Appends the n bools at vals to the end of the array, packing them
+        // a word at a time once the array ends on a word boundary.
+        void append_all(const bool* vals, size_t n) {
+            reserve(nbits_ + n);
+            size_t i = 0;
+            for (; i < n && nbits_ % 64 != 0; i++) {
+                append(vals[i]);
+            }
+            for (; i < n; i += 64) {
+                size_t nbits = n - i < 64 ? n - i : 64;
+                uint64_t word = 0;
+                for (size_t b = 0; b < nbits; b++) {
+                    word |= (uint64_t)vals[i + b] << b;
+                }
+                append_word(word, nbits);
+            }
+        }
         
+        // Appends n copies of val to the end of the array, a word at a time
+        // once the array ends on a word boundary.
+        void append_fill(bool val, size_t n) {
+            reserve(nbits_ + n);
+            size_t i = 0;
+            for (; i < n && nbits_ % 64 != 0; i++) {
+                append(val);
+            }
+            for (; i < n; i += 64) {
+                size_t nbits = n - i < 64 ? n - i : 64;
+                uint64_t word = !val ? 0 : nbits == 64 ? ~(uint64_t)0 : ((uint64_t)1 << nbits) - 1;
+                append_word(word, nbits);
+            }
+        }
+
         // Sets the element at index to val.
         // If index == size(), appends to the end of the array.
-        void set(bool val, size_t index) { 
-            assert(index >= 0);
-            assert(index <= size_);
+        void set(bool val, size_t index) {
+            assert(index <= nbits_);
 
-            if (index == size_) {
+            if (index == nbits_) {
                 append(val);
                 return;
             }
 
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            bools_[outer_idx][inner_idx] = val;
+            uint64_t bit = (uint64_t)1 << (index % 64);
+            uint64_t word = get_word(index / 64);
+            set_word(index / 64, val ? word | bit : word & ~bit);
         }
         
         // Gets the element at the given index.
         bool get(size_t index) { 
-            assert(index >= 0);
-            assert(index < size_);
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            return bools_[outer_idx][inner_idx];
+            assert(index < nbits_);
+            return (get_word(index / 64) >> (index % 64)) & 1;
         }
         
         // Returns if the array contains val.
         bool contains(bool val) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    if (bools_[i][j % INNER_CAPACITY] == val) return true;
-                }
-                count++;
-            }
-            return false;
+            return index_of(val) < nbits_;
         }
         
         // Returns the first index of the val.
         // If val does not exist in the array, returns -1.
         size_t index_of(bool val) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    if (bools_[i][j % INNER_CAPACITY] == val) return count;
+            for (size_t w = 0; w < size_; w++) {
+                uint64_t word = val ? get_word(w) : ~get_word(w);
+                if (word != 0) {
+                    size_t idx = w * 64 + __builtin_ctzll(word);
+                    return idx < nbits_ ? idx : -1;
                 }
-                count++;
             }
             return -1;
         }
+
+        // Returns the index of the first true element at or after from, or
+        // size() if there is none.
+        size_t next_set(size_t from) {
+            if (from >= nbits_) return nbits_;
+            size_t w = from / 64;
+            uint64_t word = get_word(w) & (~(uint64_t)0 << (from % 64));
+            while (word == 0) {
+                if (++w >= size_) return nbits_;
+                word = get_word(w);
+            }
+            return w * 64 + __builtin_ctzll(word);
+        }
+
+        // Returns the number of true elements.
+        size_t count_true() {
+            size_t count = 0;
+            for (size_t k = 0; k < chunk_count_; k++) {
+                uint64_t* words = chunk(k);
+                size_t len = chunk_length(k);
+                for (size_t i = 0; i < len; i++) {
+                    count += __builtin_popcountll(words[i]);
+                }
+            }
+            return count;
+        }
         
         // Returns the number of elements.
         size_t size() {
-            return size_;
+            return nbits_;
         }
 
         // Inherited from Object
@@ -322,90 +632,74 @@ class BoolArray : public Object {
         bool equals(Object* o) {
             BoolArray* other = dynamic_cast<BoolArray*>(o);
             if (other == nullptr) return false;
-            if (size_ == 0) return other->size() == 0;
+            if (nbits_ != other->size()) return false;
 
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    int inner_idx = j % INNER_CAPACITY;
-                    if (!(bools_[i][inner_idx] == other->get(count))) return false;
-                    count++;
-                } 
+            for (size_t w = 0; w < size_; w++) {
+                if (get_word(w) != other->get_word(w)) return false;
             }
 
             return true;
         }
 };
 
+/**
+ * Iterates over the indices of the true elements of a BoolArray, skipping
+ * 64 false elements at a time.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class SetBitIterator : public Object {
+    public:
+        // The array being iterated over, external
+        BoolArray* bits_;
+        size_t next_;
+
+        SetBitIterator(BoolArray* bits) {
+            bits_ = bits;
+            next_ = bits_->next_set(0);
+        }
+
+        // Are there any true elements left?
+        bool has_next() {
+            return next_ < bits_->size();
+        }
+
+        // Returns the index of the next true element and moves past it.
+        size_t next() {
+            assert(has_next());
+            size_t idx = next_;
+            next_ = bits_->next_set(idx + 1);
+            return idx;
+        }
+};
+
 /**
  * Represents an array (Java: List) of integers.
  * In order to have constant time lookup and avoid copying the payload of the array,
- * this data structure is an array of array pointers, essentially a 2D array.
- * The inner arrays have a fixed length and when the outer array runs out of space,
- * a new array is allocated and the inner array pointers are transferred to it.
+ * the elements are kept in chunks that never move once they are full
+ * (see ChunkedStorage).
  * 
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  */
-class IntArray : public Object {
+class IntArray : public ChunkedStorage {
     public:
-        int** ints_;
-        int size_;
-        // Number of inner arrays that we have space for
-        int outer_capacity_; 
-        // Number of inner arrays that have been initialized
-        int array_count_;
-
         /**
          * Constructor for an IntArray.
          * 
         */ 
-        IntArray() {
-            size_ = 0;
-            outer_capacity_ = INITIAL_OUTER_CAPACITY;
-            array_count_ = 1;
-            ints_ = new int*[outer_capacity_];
-            ints_[0] = new int[INNER_CAPACITY];
-        } 
-
-        /**
-         * Destructor for an IntArray.
-         * 
-        */ 
-        ~IntArray() {
-            delete[] ints_;
-        }
-
-        /*
-         * Private function that reallocates more space for the IntArray
-         * once it fills up.
-         */
-        void reallocate_() {
-            int** new_outer_arr = new int*[outer_capacity_ + INITIAL_OUTER_CAPACITY]; 
-
-            int** old_outer_arr = ints_;
-            for (int i = 0; i < array_count_; i++) {
-                new_outer_arr[i] = old_outer_arr[i];
-            }
-            delete[] old_outer_arr;
-            ints_ = new_outer_arr;
+        IntArray() : ChunkedStorage(sizeof(int)) { }
 
-            outer_capacity_ += INITIAL_OUTER_CAPACITY;
+        // Returns the chunk k as an array of integers.
+        int* chunk(size_t k) {
+            return reinterpret_cast<int*>(chunks_[k]);
         }
-        
+    
         // Appends val onto the end of the array
         void append(int val) {
-            // If all of the inner arrays are full, allocate more memory for the outer one.
-            if (size_ + 1 > outer_capacity_ * INNER_CAPACITY) reallocate_();
-            // If the last inner array is full, create a new one and add val to it.
-            if (size_ + 1 > array_count_ * INNER_CAPACITY) {
-                ints_[array_count_] = new int[INNER_CAPACITY];
-                ints_[array_count_][0] = val;
-                array_count_++;
-            } else {
-                ints_[array_count_ - 1][size_ % INNER_CAPACITY] = val;
-            }
+            if (size_ == capacity_) grow_();
+            chunk(size_ >> ARRAY_CHUNK_SHIFT)[size_ & ARRAY_CHUNK_MASK] = val;
             size_++;
         }
         
@@ -413,15 +707,17 @@ class IntArray : public Object {
         // If vals is null, does nothing.
         void append_all(IntArray* vals) {
             if (vals == NULL) return;
-            for (int i = 0; i < vals->size(); i++) {
-                append(vals->get(i));
-            }
+            append_storage(vals);
+        }
+
+        // Appends the n ints at vals to the end of the array.
+        void append_all(const int* vals, size_t n) {
+            append_data(reinterpret_cast<const char*>(vals), n);
         }
         
         // Sets the element at index to val.
         // If index == size(), appends to the end of the array.
         void set(int val, size_t index) {
-            assert(index >= 0);
             assert(index <= size_);
 
             if (index == size_) {
@@ -429,69 +725,38 @@ class IntArray : public Object {
                 return;
             }
 
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            ints_[outer_idx][inner_idx] = val;
+            chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK] = val;
         }
         
         // Gets the element at index.
-        // If index is >= size(), does nothing and returns undefined.
         int get(size_t index) {
-            assert(index >= 0);
             assert(index < size_);
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            return ints_[outer_idx][inner_idx];
+            return chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK];
         }
         
         // Returns if the array contains val.
         bool contains(int val) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    if (ints_[i][j % INNER_CAPACITY] == val) return true;
-                }
-                count++;
-            }
-            return false;
+            return index_of(val) < size_;
         }
         
-        
         // Returns the first index of the val.
         // If val does not exist in the array, returns -1.
         size_t index_of(int val) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    if (ints_[i][j % INNER_CAPACITY] == val) return count;
-                }
-                count++;
+            for (size_t i = 0; i < size_; i++) {
+                if (get(i) == val) return i;
             }
             return -1;
         }
-        
-        // Returns the number of elements.
-        size_t size() {
-            return size_;
-        }
 
         // Inherited from Object
         // Is this Array equal to the given Object?
         bool equals(Object* o) {
             IntArray* other = dynamic_cast<IntArray*>(o);
             if (other == nullptr) return false;
-            if (size_ == 0) return other->size() == 0;
+            if (size_ != other->size()) return false;
 
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    int inner_idx = j % INNER_CAPACITY;
-                    if (!(ints_[i][inner_idx] == other->get(count))) return false;
-                    count++;
-                } 
+            for (size_t i = 0; i < size_; i++) {
+                if (get(i) != other->get(i)) return false;
             }
 
             return true;
@@ -501,71 +766,29 @@ class IntArray : public Object {
 /**
  * Represents an array (Java: List) of floats.
  * In order to have constant time lookup and avoid copying the payload of the array,
- * this data structure is an array of array pointers, essentially a 2D array.
- * The inner arrays have a fixed length and when the outer array runs out of space,
- * a new array is allocated and the inner array pointers are transferred to it.
+ * the elements are kept in chunks that never move once they are full
+ * (see ChunkedStorage).
  * 
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  */
-class FloatArray : public Object {
+class FloatArray : public ChunkedStorage {
     public:
-        float** floats_;
-        int size_;
-        // Number of inner arrays that we have space for
-        int outer_capacity_; 
-        // Number of inner arrays that have been initialized
-        int array_count_;
-
         /**
          * Constructor for a FloatArray.
          * 
         */ 
-        FloatArray() {
-            size_ = 0;
-            outer_capacity_ = INITIAL_OUTER_CAPACITY;
-            array_count_ = 1;
-            floats_ = new float*[outer_capacity_];
-            floats_[0] = new float[INNER_CAPACITY];
-        }
+        FloatArray() : ChunkedStorage(sizeof(float)) { }
 
-        /**
-         * Destructor for a FloatArray.
-         * 
-        */ 
-        ~FloatArray() {
-            delete[] floats_;
+        // Returns the chunk k as an array of floats.
+        float* chunk(size_t k) {
+            return reinterpret_cast<float*>(chunks_[k]);
         }
-        
-        /*
-         * Private function that reallocates more space for the FloatArray
-         * once it fills up.
-         */
-        void reallocate_() {
-            float** new_outer_arr = new float*[outer_capacity_ + INITIAL_OUTER_CAPACITY];
-
-            float** old_outer_arr = floats_;
-            for (int i = 0; i < array_count_; i++) {
-                new_outer_arr[i] = old_outer_arr[i];
-            }
-            delete[] old_outer_arr;
-            floats_ = new_outer_arr;
-
-            outer_capacity_ += INITIAL_OUTER_CAPACITY;
-        }
-
+    
         // Appends val onto the end of the array
         void append(float val) {
-            // If all of the inner arrays are full, allocate more memory for the outer one.
-            if (size_ + 1 > outer_capacity_ * INNER_CAPACITY) reallocate_();
-            // If the last inner array is full, create a new one and add val to it.
-            if (size_ + 1 > array_count_ * INNER_CAPACITY) {
-                floats_[array_count_] = new float[INNER_CAPACITY];
-                floats_[array_count_][0] = val;
-                array_count_++;
-            } else {
-                floats_[array_count_ - 1][size_ % INNER_CAPACITY] = val;
-            }
+            if (size_ == capacity_) grow_();
+            chunk(size_ >> ARRAY_CHUNK_SHIFT)[size_ & ARRAY_CHUNK_MASK] = val;
             size_++;
         }
         
@@ -573,15 +796,17 @@ class FloatArray : public Object {
         // If vals is null, does nothing.
         void append_all(FloatArray* vals) {
             if (vals == NULL) return;
-            for (int i = 0; i < vals->size(); i++) {
-                append(vals->get(i));
-            }
+            append_storage(vals);
+        }
+
+        // Appends the n floats at vals to the end of the array.
+        void append_all(const float* vals, size_t n) {
+            append_data(reinterpret_cast<const char*>(vals), n);
         }
         
         // Sets the element at index to val.
         // If index == size(), appends to the end of the array.
         void set(float val, size_t index) {
-            assert(index >= 0);
             assert(index <= size_);
 
             if (index == size_) {
@@ -589,70 +814,227 @@ class FloatArray : public Object {
                 return;
             }
 
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            floats_[outer_idx][inner_idx] = val;
+            chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK] = val;
         }
         
         // Gets the element at index.
         float get(size_t index) {
-            assert(index >= 0);
             assert(index < size_);
-            int outer_idx = index / INNER_CAPACITY;
-            int inner_idx = index % INNER_CAPACITY;
-            return floats_[outer_idx][inner_idx];
+            return chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK];
         }
         
         // Returns if the array contains val.
         bool contains(float val) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    if (floats_[i][j % INNER_CAPACITY] == val) return true;
-                }
-                count++;
-            }
-            return false;
+            return index_of(val) < size_;
         }
         
         // Returns the first index of the val.
-        // If val does not exist in the array, 
-        //    returns a value greater than size().
+        // If val does not exist in the array, returns -1.
         size_t index_of(float val) {
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    if (floats_[i][j % INNER_CAPACITY] == val) return count;
-                }
-                count++;
+            for (size_t i = 0; i < size_; i++) {
+                if (get(i) == val) return i;
             }
             return -1;
         }
-        
-        // Returns the number of elements.
-        size_t size() {
-            return size_;
-        }
 
         // Inherited from Object
         // Is this Array equal to the given Object?
         bool equals(Object* o) {
             FloatArray* other = dynamic_cast<FloatArray*>(o);
             if (other == nullptr) return false;
-            if (size_ == 0) return other->size() == 0;
+            if (size_ != other->size()) return false;
 
-            // count is the total number of items read in the array so far
-            int count = 0;
-            for (int i = 0; i < array_count_ && count < size_; i++) {
-                for (int j = 0; j < INNER_CAPACITY && count < size_; j++) {
-                    int inner_idx = j % INNER_CAPACITY;
-                    if (!(floats_[i][inner_idx] == other->get(count))) return false;
-                    count++;
-                } 
+            for (size_t i = 0; i < size_; i++) {
+                if (get(i) != other->get(i)) return false;
             }
 
             return true;
         }
 };
+/**
+ * Represents an array (Java: List) of sizes, such as byte offsets into a file
+ * that can be larger than an int allows. Elements are kept in chunks like the
+ * other arrays (see ChunkedStorage).
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class SizeArray : public ChunkedStorage {
+    public:
+        /**
+         * Constructor for a SizeArray.
+         */
+        SizeArray() : ChunkedStorage(sizeof(size_t)) { }
+
+        // Returns the chunk k as an array of sizes.
+        size_t* chunk(size_t k) {
+            return reinterpret_cast<size_t*>(chunks_[k]);
+        }
+
+        // Appends val onto the end of the array
+        void append(size_t val) {
+            if (size_ == capacity_) grow_();
+            chunk(size_ >> ARRAY_CHUNK_SHIFT)[size_ & ARRAY_CHUNK_MASK] = val;
+            size_++;
+        }
+
+        // Sets the element at index to val.
+        // If index == size(), appends to the end of the array.
+        void set(size_t val, size_t index) {
+            assert(index <= size_);
+
+            if (index == size_) {
+                append(val);
+                return;
+            }
+
+            chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK] = val;
+        }
+
+        // Gets the element at index.
+        size_t get(size_t index) {
+            assert(index < size_);
+            return chunk(index >> ARRAY_CHUNK_SHIFT)[index & ARRAY_CHUNK_MASK];
+        }
+};
+
+// Size of the first block of a CharArena; each later block is twice the size
+// of the one before, up to ARRAY_CHUNK_SIZE
+#define ARENA_FIRST_BLOCK 256
+// Number of low bits of an arena offset that hold the position in the block
+#define ARENA_POS_BITS 40
+#define ARENA_POS_MASK (((size_t)1 << ARENA_POS_BITS) - 1)
+
+/**
+ * Stores the characters of many strings in a few large blocks instead of one
+ * allocation per string. Strings are appended null-terminated and never move,
+ * so the characters returned by at() stay valid until the arena is deleted.
+ * A string is identified by its offset, which packs the index of its block
+ * and its position in that block.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class CharArena : public Object {
+    public:
+        char** blocks_;
+        // Whether each block was allocated by this arena, rather than
+        // borrowed (see borrow)
+        bool* owned_;
+        size_t block_count_;
+        // Number of blocks that the block table has space for
+        size_t outer_capacity_;
+        // Size of the last block and number of its bytes in use
+        size_t block_size_;
+        size_t used_;
+        // Number of bytes of the blocks this arena allocated
+        size_t bytes_;
+
+        /**
+         * Initialize an empty arena, which allocates nothing until the first
+         * string is added.
+         */
+        CharArena() {
+            outer_capacity_ = INITIAL_OUTER_CAPACITY;
+            blocks_ = new char*[outer_capacity_];
+            owned_ = new bool[outer_capacity_];
+            block_count_ = 0;
+            block_size_ = 0;
+            used_ = 0;
+            bytes_ = 0;
+        }
+
+        /**
+         * Destructor, frees every block that isn't borrowed.
+         */
+        ~CharArena() {
+            for (size_t i = 0; i < block_count_; i++) {
+                if (owned_[i]) delete[] blocks_[i];
+            }
+            delete[] blocks_;
+            delete[] owned_;
+        }
+
+        /**
+         * Private function that puts the given block at the end of the table
+         * and makes it the one that strings are added to.
+         */
+        void add_block_(char* block, size_t size, size_t used, bool owned) {
+            if (block_count_ == outer_capacity_) {
+                char** blocks = new char*[outer_capacity_ * 2];
+                bool* owned_arr = new bool[outer_capacity_ * 2];
+                memcpy(blocks, blocks_, block_count_ * sizeof(char*));
+                memcpy(owned_arr, owned_, block_count_ * sizeof(bool));
+                delete[] blocks_;
+                delete[] owned_;
+                blocks_ = blocks;
+                owned_ = owned_arr;
+                outer_capacity_ *= 2;
+            }
+            assert(block_count_ <= (SIZE_MAX >> ARENA_POS_BITS));
+            blocks_[block_count_] = block;
+            owned_[block_count_] = owned;
+            block_count_++;
+            block_size_ = size;
+            used_ = used;
+        }
+
+        // Copies the len characters at chars and a terminator into the arena
+        // and returns the offset of the copy.
+        size_t add(const char* chars, size_t len) {
+            if (block_size_ - used_ < len + 1) {
+                size_t size = block_size_ == 0 ? ARENA_FIRST_BLOCK : block_size_ * 2;
+                if (size > ARRAY_CHUNK_SIZE) size = ARRAY_CHUNK_SIZE;
+                // A string that doesn't fit in a regular block gets its own
+                if (size < len + 1) size = len + 1;
+                add_block_(new char[size], size, 0, true);
+                bytes_ += size;
+            }
+            size_t offset = ((block_count_ - 1) << ARENA_POS_BITS) | used_;
+            memcpy(blocks_[block_count_ - 1] + used_, chars, len);
+            blocks_[block_count_ - 1][used_ + len] = '\0';
+            used_ += len + 1;
+            return offset;
+        }
+
+        // Returns the number of bytes of the blocks this arena allocated,
+        // not counting borrowed ones.
+        size_t footprint() {
+            return bytes_;
+        }
+
+        // Returns the characters stored at the given offset.
+        char* at(size_t offset) {
+            return blocks_[offset >> ARENA_POS_BITS] + (offset & ARENA_POS_MASK);
+        }
+
+        // Adds the n bytes at data to the arena as a block of their own,
+        // without copying them, and returns the offset of the first byte.
+        // Offsets into the block are that offset plus the position in data.
+        // The block is never freed or written to, so data must outlive the
+        // arena.
+        size_t borrow(char* data, size_t n) {
+            assert(n <= ARENA_POS_MASK);
+            add_block_(data, n, n, false);
+            return (block_count_ - 1) << ARENA_POS_BITS;
+        }
+
+        // Moves every block of other onto the end of this arena, without
+        // copying any characters, and leaves other empty. Returns the amount
+        // to add to an offset of other to get the offset of the same string
+        // in this arena.
+        size_t take_blocks(CharArena* other) {
+            size_t base = block_count_ << ARENA_POS_BITS;
+            for (size_t i = 0; i < other->block_count_; i++) {
+                bool last = i + 1 == other->block_count_;
+                add_block_(other->blocks_[i], last ? other->block_size_ : 0,
+                           last ? other->used_ : 0, other->owned_[i]);
+            }
+            bytes_ += other->bytes_;
+            other->block_count_ = 0;
+            other->block_size_ = 0;
+            other->used_ = 0;
+            other->bytes_ = 0;
+            return base;
+        }
+};
@@ -54,6 +54,23 @@ class SumRower : public Rower {
         bool accept(Row& r) {
             r.visit(r.get_idx(), *sf_);
             total_ += sf_->get_total();
+            return true;
+        }
+
+        bool accept(RowView& r) {
+            r.visit(r.get_idx(), *sf_);
+            total_ += sf_->get_total();
+            return true;
+        }
+
+        void accept(RowBlock& b) {
+            for (size_t col = 0; col < b.width(); col++) {
+                if (b.col_type(col) != 'I') continue;
+                const int* ints = b.ints(col);
+                for (size_t i = 0; i < b.length(); i++) {
+                    total_ += ints[i];
+                }
+            }
         }
 
         size_t get_total() {
@@ -74,8 +91,8 @@ class SumRower : public Rower {
 /**
  * A Fielder that increments every int and float and switches every boolean
  * it finds in a DataFrame and returns a new DataFrame with filled with the incremented values.
- * The new DataFrame also contains a new column with the sums of all of the ints in the DF up to
- * that row.
+ * add_sums() then adds a new column with the sums of all of the ints in the new DF up to
+ * each row, computed by DataFrame::prefix_sum.
  * 
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
@@ -92,17 +109,13 @@ class IncrementFielder : public Fielder {
         size_t row_index_;
         // The index within the row we're traversing.
         size_t col_index_;
-        // Rower used to calculate the sums for the new column.
-        SumRower* sr_;
         // Name of the new sum column.
         String* new_col_name_;
 
         IncrementFielder(DataFrame* df) {
             df_ = df;
-            Schema* new_schema = new Schema(df_->get_schema());
             new_col_name_ = new String("sums");
-            new_df_ = new DataFrame(*new_schema);
-            new_df_->add_column(new FloatColumn(), new_col_name_);
+            new_df_ = new DataFrame(df_->get_schema());
             new_row_ = new Row(new_df_->get_schema());
             row_index_ = 0;
         }
@@ -114,19 +127,23 @@ class IncrementFielder : public Fielder {
 
         void start(size_t r) {
             col_index_ = 0;
-            sr_ = new SumRower();
         }
         void done() {
-            // Temporarily setting the field in the sum column to 0. Will be
-            // replaced after map is ran.
-            new_row_->set(col_index_, 0.0f);
             new_df_->add_row(*new_row_);
-            // Calculate the sum of all the ints up to the current row and add
-            // it to the new column in the new DF.
-            new_df_->map(*sr_);
-            new_df_->set(new_df_->ncols() - 1, row_index_, (float) sr_->get_total());
             row_index_++;
-            delete sr_;
+        }
+
+        // Adds the sum column to the new DF once every row is in, with the
+        // sum of all the ints up to each row.
+        void add_sums() {
+            Schema& schema = new_df_->get_schema();
+            size_t* int_cols = new size_t[schema.width()];
+            size_t nints = 0;
+            for (size_t i = 0; i < schema.width(); i++) {
+                if (schema.col_type(i) == 'I') int_cols[nints++] = i;
+            }
+            new_df_->add_column(new_df_->prefix_sum(int_cols, nints), new_col_name_);
+            delete[] int_cols;
         }
 
         void accept(bool b) { 
@@ -138,7 +155,7 @@ class IncrementFielder : public Fielder {
             col_index_++;
         }
         void accept(String* s) { 
-            new_row_->set(col_index_, s->clone());
+            new_row_->set(col_index_, s);
             col_index_++;
         }
         void accept(int i) {
@@ -154,8 +171,8 @@ class IncrementFielder : public Fielder {
 /**
  * A Rower that increments every int and float and switches every boolean
  * it finds in a row using a fielder. It then adds these new values to a new DataFrame.
- * The new DataFrame also contains a new column with the sums of all of the ints in the DF up to
- * that row.
+ * Once every row has been visited, finish() adds a new column with the sums of all of the ints
+ * in the new DF up to that row.
  * 
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
@@ -173,31 +190,35 @@ class IncrementRower : public Rower {
 
         bool accept(Row& r) {
             r.visit(r.get_idx(), *if_);
+            return true;
+        }
+
+        bool accept(RowView& r) {
+            r.visit(r.get_idx(), *if_);
+            return true;
         }
 
         DataFrame* get_new_df() {
             return if_->get_new_df();
         }
 
+        // Adds the sum column to the new DF, after the map is done.
+        void finish() {
+            if_->add_sums();
+        }
+
         void join_delete(Rower* other) {
             IncrementRower* o = dynamic_cast<IncrementRower*>(other);
             DataFrame* o_df = o->get_new_df();
             DataFrame* new_df_ = if_->get_new_df();
             
-            int ncols = new_df_->ncols();
-            int nrows = new_df_->nrows();
-            // The last field in this Rower's DF's sum column.
-            // Will be added to every field in other's DF's sum column.
-            float r1_sum = new_df_->get_float(ncols - 1, nrows - 1);
-            float r2_sum;
-            Row* row = new Row(new_df_->get_schema());
-            for (int i = 0; i < o_df->nrows(); i++) {
-                r2_sum = o_df->get_float(ncols - 1, i);
-                o_df->set(ncols - 1, i, r1_sum + r2_sum);
-                o_df->fill_row(i, *row);
-                new_df_->add_row(*row);
+            Array* o_cols = o_df->get_columns();
+            Column** cols = new Column*[o_cols->size()];
+            for (size_t i = 0; i < o_cols->size(); i++) {
+                cols[i] = static_cast<Column*>(o_cols->get(i));
             }
-            delete row;
+            new_df_->append_columns(cols);
+            delete[] cols;
             delete o;
         }
 
@@ -206,59 +227,193 @@ class IncrementRower : public Rower {
         }
 };
 
-void map_example_1(DataFrame* df) {
+// The number of threads that example 3 checks a group_by on, whatever the hardware, so that
+// workers steal chunks from each other
+#define CHECK_THREADS 4
+
+// Returns the sum of every int in the given DataFrame.
+size_t int_total(DataFrame* df) {
+    SumRower sr;
+    df->map(sr);
+    return sr.get_total();
+}
+
+// Prints the number of rows of the DataFrame built by example 2, the sum of its ints and its last
+// prefix sum.
+void print_example_2(DataFrame* df) {
+    size_t last = df->ncols() - 1;
+    float sum = df->nrows() == 0 ? 0 : df->get_float(last, df->nrows() - 1);
+    printf("Rows: %zu, int total: %zu, last sum: %f\n", df->nrows(), int_total(df), sum);
+}
+
+void map_example_1(ParserMain* pf) {
     printf("EXAMPLE 1 MAP:\n");
     SumRower* sr = new SumRower();
-    df->map(*sr);
+    pf->map(*sr);
+    printf("Total: %zu\n", sr->get_total());
     delete sr;
 }
 
-void pmap_example_1(DataFrame* df) {
+void pmap_example_1(ParserMain* pf) {
     printf("EXAMPLE 1 PMAP:\n");
     SumRower* sr = new SumRower();
-    df->pmap(*sr);
+    pf->pmap(*sr);
+    printf("Total: %zu\n", sr->get_total());
     delete sr;
 }
 
-void map_example_2(DataFrame* df) {
+void map_example_2(ParserMain* pf) {
     printf("EXAMPLE 2 MAP:\n");
-    IncrementRower* ir = new IncrementRower(df);
-    df->map(*ir);
-    // ir->get_new_df()->print();
+    IncrementRower* ir = new IncrementRower(pf->get_dataframe());
+    pf->map(*ir);
+    ir->finish();
+    print_example_2(ir->get_new_df());
     delete ir;
 }
 
-void pmap_example_2(DataFrame* df) {
+void pmap_example_2(ParserMain* pf) {
     printf("EXAMPLE 2 PMAP:\n");
-    IncrementRower* ir = new IncrementRower(df);
-    df->pmap(*ir);
-    // ir->get_new_df()->print();
+    IncrementRower* ir = new IncrementRower(pf->get_dataframe());
+    pf->pmap(*ir);
+    ir->finish();
+    print_example_2(ir->get_new_df());
     delete ir;
 }
 
+// Runs example 1 with both pmap and map, and terminates unless they find the same total.
+void check_example_1(ParserMain* pf) {
+    printf("EXAMPLE 1 CHECK:\n");
+    Sys sys;
+    sys.exit_if_not(!pf->streaming(), "-c needs the whole file, it can't be used with -stream");
+    SumRower* parallel = new SumRower();
+    pf->pmap(*parallel);
+    SumRower* serial = new SumRower();
+    pf->map(*serial);
+    printf("Total: %zu (pmap), %zu (map)\n", parallel->get_total(), serial->get_total());
+    sys.exit_if_not(parallel->get_total() == serial->get_total(), "pmap and map disagree");
+    delete parallel;
+    delete serial;
+}
+
+// Runs example 2 with both pmap and map, and terminates unless they build DataFrames with the
+// same rows.
+void check_example_2(ParserMain* pf) {
+    printf("EXAMPLE 2 CHECK:\n");
+    Sys sys;
+    sys.exit_if_not(!pf->streaming(), "-c needs the whole file, it can't be used with -stream");
+    IncrementRower* parallel = new IncrementRower(pf->get_dataframe());
+    pf->pmap(*parallel);
+    parallel->finish();
+    IncrementRower* serial = new IncrementRower(pf->get_dataframe());
+    pf->map(*serial);
+    serial->finish();
+    DataFrame* a = parallel->get_new_df();
+    DataFrame* b = serial->get_new_df();
+    print_example_2(a);
+    print_example_2(b);
+    sys.exit_if_not(a->nrows() == b->nrows() && a->ncols() == b->ncols(), "pmap and map disagree");
+    for (size_t col = 0; col < a->ncols(); col++) {
+        char type = a->get_schema().col_type(col);
+        for (size_t row = 0; row < a->nrows(); row++) {
+            bool same = a->is_missing(col, row) == b->is_missing(col, row);
+            if (same && !a->is_missing(col, row)) {
+                switch (type) {
+                    case 'I': same = a->get_int(col, row) == b->get_int(col, row); break;
+                    case 'B': same = a->get_bool(col, row) == b->get_bool(col, row); break;
+                    case 'F': same = a->get_float(col, row) == b->get_float(col, row); break;
+                    default: {
+                        String* x = a->get_string(col, row);
+                        String* y = b->get_string(col, row);
+                        same = x->equals(y);
+                        delete x;
+                        delete y;
+                    }
+                }
+            }
+            sys.exit_if_not(same, "pmap and map disagree");
+        }
+    }
+    delete parallel;
+    delete serial;
+}
+
+// Groups the rows by the first int or string column, counting them, on one thread and on
+// CHECK_THREADS threads, and terminates unless both list the same groups in the same order.
+void check_example_3(ParserMain* pf) {
+    printf("EXAMPLE 3 CHECK:\n");
+    Sys sys;
+    sys.exit_if_not(!pf->streaming(), "-c needs the whole file, it can't be used with -stream");
+    DataFrame* df = pf->get_dataframe();
+    size_t key = 0;
+    while (key < df->ncols() && df->get_schema().col_type(key) != 'I' &&
+           df->get_schema().col_type(key) != 'S') {
+        key++;
+    }
+    sys.exit_if_not(key < df->ncols(), "Example 3 needs an int or string column");
+    size_t cols[] = {key};
+    const char aggs[] = {AGG_COUNT};
+    df->set_num_threads(1);
+    DataFrame* serial = df->group_by(key, cols, aggs, 1);
+    df->set_num_threads(CHECK_THREADS);
+    DataFrame* parallel = df->group_by(key, cols, aggs, 1);
+    printf("Groups: %zu (parallel), %zu (serial)\n", parallel->nrows(), serial->nrows());
+    sys.exit_if_not(parallel->nrows() == serial->nrows(), "Parallel and serial group_by disagree");
+    for (size_t row = 0; row < serial->nrows(); row++) {
+        bool same = parallel->is_missing(0, row) == serial->is_missing(0, row) &&
+                    parallel->get_int(1, row) == serial->get_int(1, row);
+        if (same && !serial->is_missing(0, row)) {
+            if (df->get_schema().col_type(key) == 'I') {
+                same = parallel->get_int(0, row) == serial->get_int(0, row);
+            } else {
+                String* x = parallel->get_string(0, row);
+                String* y = serial->get_string(0, row);
+                same = x->equals(y);
+                delete x;
+                delete y;
+            }
+        }
+        sys.exit_if_not(same, "Parallel and serial group_by disagree");
+    }
+    delete parallel;
+    delete serial;
+}
+
 int main(int argc, char** argv) {
+    // With -stream, the examples parse and map the file one chunk at a time
     ParserMain* pf = new ParserMain(argc, argv);
-    DataFrame* df = new DataFrame(*(pf->get_dataframe()));
     Sys sys;
-    if (strcmp(argv[1], "-p") == 0) {
+    // -c runs an example with both pmap and map and compares the results. Example 3 compares a
+    // group_by on one thread with one on CHECK_THREADS threads
+    if (strcmp(argv[1], "-c") == 0) {
+        sys.exit_if_not(strcmp(argv[2], "-e") == 0, "Please specify which example you would like to check using -e [1,2,3]");
+        if (strcmp(argv[3], "1") == 0) {
+            check_example_1(pf);
+        } else if (strcmp(argv[3], "2") == 0) {
+            check_example_2(pf);
+        } else if (strcmp(argv[3], "3") == 0) {
+            check_example_3(pf);
+        } else {
+            sys.exit_if_not(false, "Please specify which example you would like to check using -e [1,2,3]");
+        }
+    } else if (strcmp(argv[1], "-p") == 0) {
         sys.exit_if_not(strcmp(argv[2], "-e") == 0, "Please specify which example you would like to run using -e [1,2]");
         if (strcmp(argv[3], "1") == 0) {
-            pmap_example_1(df);
+            pmap_example_1(pf);
         } else if (strcmp(argv[3], "2") == 0) {
-            pmap_example_2(df);
+            pmap_example_2(pf);
         } else {
             sys.exit_if_not(false, "Please specify which example you would like to run using -e [1,2]");
         }
     } else {
         sys.exit_if_not(strcmp(argv[1], "-e") == 0, "Please specify which example you would like to run using -e [1,2]");
         if (strcmp(argv[2], "1") == 0) {
-            map_example_1(df);
+            map_example_1(pf);
         } else if (strcmp(argv[2], "2") == 0) {
-            map_example_2(df);
+            map_example_2(pf);
         } else {
             sys.exit_if_not(false, "Please specify which example you would like to run using -e [1,2]");
         }
     }
-    delete df;
+    delete pf;
     return 0;
 }
\ No newline at end of file
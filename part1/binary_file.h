@@ -0,0 +1,351 @@
+// Lang::CwC
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "modified_dataframe.h"
+#include "mapped_file.h"
+
+/**
+ * Magic bytes at the start of every binary DataFrame file, including the terminator.
+ */
+constexpr const char BINARY_MAGIC[8] = "SORBIN1";
+
+/**
+ * Alignment of every column block in a binary DataFrame file, in bytes.
+ */
+constexpr const size_t BINARY_ALIGN = 64;
+
+/**
+ * Writes a DataFrame to a binary columnar file that BinaryReader can map back in without parsing.
+ * All numbers are stored in native byte order, so files are only meant to be read on the machine
+ * type that wrote them. The layout is:
+ *
+ *   8 bytes     magic "SORBIN1\0"
+ *   uint64      number of columns (ncols)
+ *   uint64      number of rows (nrows)
+ *   uint64      file offset of each column block, ncols of them
+ *   char        type of each column ('I', 'B', 'F' or 'S'), ncols of them
+ *
+ * followed by one block per column, each starting at a multiple of BINARY_ALIGN bytes:
+ *
+ *   I, F        nrows 32-bit ints or floats
+ *   B           (nrows + 63) / 64 uint64 words, bit i % 64 of word i / 64 is row i
+ *   S           nrows uint64 end offsets into the heap that follows, then the heap. String i is
+ *               stored null-terminated from the end offset of string i - 1 (0 for the first) up to
+ *               its own end offset. A missing string takes no bytes.
+ *
+ * An int, float or bool column with missing values has a lower case type ('i', 'f' or 'b'), and
+ * its block is followed, at the next multiple of BINARY_ALIGN bytes, by (nrows + 63) / 64 uint64
+ * words with bit i % 64 of word i / 64 set if row i is present.
+ */
+class BinaryWriter : public Object {
+   public:
+    /** The file we're writing to */
+    FILE* _file;
+    /** Number of bytes written so far */
+    size_t _pos;
+
+    /**
+     * Writes the given DataFrame to the file at the given path, replacing it. Terminates if the
+     * file cannot be written.
+     * @param df The DataFrame to write
+     * @param path The path of the file
+     */
+    BinaryWriter(DataFrame* df, const char* path) : Object() {
+        _file = fopen(path, "wb");
+        exit_if_not(_file != nullptr, "Failed to open file for writing");
+        _pos = 0;
+
+        size_t ncols = df->ncols();
+        size_t nrows = df->nrows();
+        _write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        _writeU64(ncols);
+        _writeU64(nrows);
+
+        // The column offsets follow from the block sizes, so they can be written up front
+        size_t offset = _align(sizeof(BINARY_MAGIC) + (2 + ncols) * sizeof(uint64_t) + ncols);
+        for (size_t i = 0; i < ncols; i++) {
+            _writeU64(offset);
+            Column* col = dynamic_cast<Column*>(df->get_columns()->get(i));
+            offset = _align(offset + _blockSize(col, nrows));
+            if (_hasValidity(col)) {
+                offset = _align(offset + (nrows + 63) / 64 * sizeof(uint64_t));
+            }
+        }
+        for (size_t i = 0; i < ncols; i++) {
+            char type = df->get_schema().col_type(i);
+            if (_hasValidity(dynamic_cast<Column*>(df->get_columns()->get(i)))) {
+                type = tolower(type);
+            }
+            _write(&type, 1);
+        }
+
+        for (size_t i = 0; i < ncols; i++) {
+            _pad();
+            Column* col = dynamic_cast<Column*>(df->get_columns()->get(i));
+            _writeColumn(col, nrows);
+            if (_hasValidity(col)) {
+                _pad();
+                _writeChunks(col->get_validity(), sizeof(uint64_t));
+            }
+        }
+        exit_if_not(fclose(_file) == 0, "Failed to write file");
+    }
+
+    /**
+     * @return The given offset rounded up to a multiple of BINARY_ALIGN
+     */
+    static size_t _align(size_t offset) {
+        return (offset + BINARY_ALIGN - 1) / BINARY_ALIGN * BINARY_ALIGN;
+    }
+
+    /**
+     * Writes the given bytes to the file.
+     */
+    virtual void _write(const void* bytes, size_t length) {
+        exit_if_not(fwrite(bytes, 1, length, _file) == length, "Failed to write file");
+        _pos += length;
+    }
+
+    /**
+     * Writes the given number to the file as a uint64.
+     */
+    virtual void _writeU64(size_t val) {
+        uint64_t word = val;
+        _write(&word, sizeof(word));
+    }
+
+    /**
+     * Writes zeros up to the next multiple of BINARY_ALIGN.
+     */
+    virtual void _pad() {
+        static const char zeros[BINARY_ALIGN] = {0};
+        _write(zeros, _align(_pos) - _pos);
+    }
+
+    /**
+     * @return Whether the given column is stored with a bitmap of its present values
+     */
+    static bool _hasValidity(Column* col) {
+        return col->get_type() != 'S' && col->get_validity() != nullptr;
+    }
+
+    /**
+     * Computes the size in bytes of the block for the given column.
+     * @param col The column
+     * @param nrows The number of rows to write
+     * @return The size of the block
+     */
+    virtual size_t _blockSize(Column* col, size_t nrows) {
+        switch (col->get_type()) {
+            case 'I':
+                return nrows * sizeof(int);
+            case 'F':
+                return nrows * sizeof(float);
+            case 'B':
+                return (nrows + 63) / 64 * sizeof(uint64_t);
+            case 'S': {
+                size_t size = nrows * sizeof(uint64_t);
+                StringColumn* strings = col->as_string();
+                for (size_t i = 0; i < nrows; i++) {
+                    int length = strings->get_size(i);
+                    if (length >= 0) {
+                        size += length + 1;
+                    }
+                }
+                return size;
+            }
+            default:
+                assert(false);
+        }
+        return 0;
+    }
+
+    /**
+     * Writes the block for the given column.
+     * @param col The column
+     * @param nrows The number of rows to write
+     */
+    virtual void _writeColumn(Column* col, size_t nrows) {
+        switch (col->get_type()) {
+            case 'I':
+                _writeChunks(col->as_int()->get_fields(), sizeof(int));
+                break;
+            case 'F':
+                _writeChunks(col->as_float()->get_fields(), sizeof(float));
+                break;
+            case 'B':
+                _writeChunks(col->as_bool()->get_fields(), sizeof(uint64_t));
+                break;
+            case 'S': {
+                StringColumn* strings = col->as_string();
+                size_t end = 0;
+                for (size_t i = 0; i < nrows; i++) {
+                    int length = strings->get_size(i);
+                    if (length >= 0) {
+                        end += length + 1;
+                    }
+                    _writeU64(end);
+                }
+                for (size_t i = 0; i < nrows; i++) {
+                    int length = strings->get_size(i);
+                    if (length >= 0) {
+                        _write(strings->get_chars(i), length + 1);
+                    }
+                }
+                break;
+            }
+            default:
+                assert(false);
+        }
+    }
+
+    /**
+     * Writes every element of the given storage, one chunk at a time.
+     * @param storage The storage to write
+     * @param elem_size The size of an element in bytes
+     */
+    virtual void _writeChunks(ChunkedStorage* storage, size_t elem_size) {
+        for (size_t k = 0; k < storage->chunk_count(); k++) {
+            _write(storage->chunks_[k], storage->chunk_length(k) * elem_size);
+        }
+    }
+};
+
+/**
+ * Loads a DataFrame from a file written by BinaryWriter. The file is mapped into memory and the
+ * int, float and bool columns use the mapped blocks in place, apart from a copy of their last
+ * partial storage chunk, so loading takes time proportional to the number of columns rather than
+ * rows. String columns use the mapped string heap in place too, and only build their offsets. The
+ * mapping is private, so changes to the frame never reach the file.
+ */
+class BinaryReader : public Object {
+   public:
+    /** The mapped file */
+    MappedFile* _map;
+    /** The loaded frame */
+    DataFrame* _df;
+
+    /**
+     * Loads the file at the given path. Terminates if it cannot be opened or is not a valid
+     * binary DataFrame file.
+     * @param path The path of the file
+     */
+    BinaryReader(const char* path) : Object() {
+        _map = new MappedFile(path);
+        char* data = _map->getData();
+        size_t size = _map->getSize();
+        size_t header = sizeof(BINARY_MAGIC) + 2 * sizeof(uint64_t);
+        exit_if_not(size >= header && memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0,
+                    "Not a binary DataFrame file");
+
+        uint64_t* words = reinterpret_cast<uint64_t*>(data + sizeof(BINARY_MAGIC));
+        size_t ncols = words[0];
+        size_t nrows = words[1];
+        uint64_t* offsets = &words[2];
+        exit_if_not(ncols <= (size - header) / (sizeof(uint64_t) + 1), "Truncated binary file");
+        char* types = reinterpret_cast<char*>(&offsets[ncols]);
+
+        Schema empty;
+        _df = new DataFrame(empty);
+        for (size_t i = 0; i < ncols; i++) {
+            exit_if_not(offsets[i] % BINARY_ALIGN == 0 && offsets[i] <= size,
+                        "Invalid column offset in binary file");
+            _df->add_column(_readColumn(types[i], data + offsets[i], size - offsets[i], nrows),
+                            nullptr);
+        }
+        _df->add_backing(_map);
+    }
+
+    /**
+     * Builds the column stored in the given block, and reads the bitmap of its present values that
+     * follows the block if its type is lower case.
+     * @param type The type of the column
+     * @param block The start of the block
+     * @param length The number of bytes between the start of the block and the end of the file
+     * @param nrows The number of rows in the column
+     * @return The new column
+     */
+    virtual Column* _readColumn(char type, char* block, size_t length, size_t nrows) {
+        if (type != 'i' && type != 'f' && type != 'b') {
+            return _readValues(type, block, length, nrows);
+        }
+        type = toupper(type);
+        Column* col = _readValues(type, block, length, nrows);
+        size_t data = type == 'B' ? (nrows + 63) / 64 * sizeof(uint64_t) : nrows * 4;
+        size_t offset = BinaryWriter::_align(data);
+        exit_if_not(offset <= length && (nrows + 63) / 64 <= (length - offset) / sizeof(uint64_t),
+                    "Truncated binary file");
+        col->valid_ = new BoolArray();
+        col->valid_->borrow_words(reinterpret_cast<uint64_t*>(block + offset), nrows);
+        return col;
+    }
+
+    /**
+     * Builds the column of the given upper case type whose values are stored in the given block.
+     * @param type The type of the column
+     * @param block The start of the block
+     * @param length The number of bytes between the start of the block and the end of the file
+     * @param nrows The number of rows in the column
+     * @return The new column
+     */
+    virtual Column* _readValues(char type, char* block, size_t length, size_t nrows) {
+        switch (type) {
+            case 'I': {
+                exit_if_not(nrows <= length / sizeof(int), "Truncated binary file");
+                IntColumn* col = new IntColumn();
+                col->get_fields()->borrow(block, nrows);
+                return col;
+            }
+            case 'F': {
+                exit_if_not(nrows <= length / sizeof(float), "Truncated binary file");
+                FloatColumn* col = new FloatColumn();
+                col->get_fields()->borrow(block, nrows);
+                return col;
+            }
+            case 'B': {
+                exit_if_not((nrows + 63) / 64 <= length / sizeof(uint64_t), "Truncated binary file");
+                BoolColumn* col = new BoolColumn();
+                col->get_fields()->borrow_words(reinterpret_cast<uint64_t*>(block), nrows);
+                return col;
+            }
+            case 'S': {
+                exit_if_not(nrows <= length / sizeof(uint64_t), "Truncated binary file");
+                uint64_t* ends = reinterpret_cast<uint64_t*>(block);
+                char* heap = block + nrows * sizeof(uint64_t);
+                size_t heap_length = length - nrows * sizeof(uint64_t);
+                StringColumn* col = new StringColumn();
+                col->offsets_->reserve(nrows);
+                col->sizes_->reserve(nrows);
+                // The heap becomes a block of the column's arena, so no characters are copied
+                size_t base = col->chars_->borrow(heap, heap_length);
+                size_t start = 0;
+                for (size_t i = 0; i < nrows; i++) {
+                    exit_if_not(ends[i] >= start && ends[i] <= heap_length,
+                                "Invalid string offset in binary file");
+                    if (ends[i] == start) {
+                        col->append_missing();
+                    } else {
+                        exit_if_not(heap[ends[i] - 1] == '\0', "Invalid string in binary file");
+                        col->offsets_->append(base + start);
+                        col->sizes_->append(ends[i] - start - 1);
+                    }
+                    start = ends[i];
+                }
+                return col;
+            }
+            default:
+                exit_if_not(false, "Invalid column type in binary file");
+        }
+        return nullptr;
+    }
+
+    /**
+     * Gets the loaded frame. It owns the mapped file, which stays mapped until the frame is
+     * deleted.
+     * @return The frame. Caller must free.
+     */
+    virtual DataFrame* getDataFrame() { return _df; }
+};
@@ -5,12 +5,33 @@
 #include "object.h"
 #include "string.h"
 #include "array.h"
+#include "aggregate.h"
+#include "string_map.h"
+#include "thread.h"
 #include <stdarg.h>
+#include <atomic>
 
 class IntColumn;
 class BoolColumn;
 class FloatColumn;
 class StringColumn;
+class Column;
+
+/**
+ * Source of the values of a column that is loaded lazily: the column stays
+ * empty until one of its values is first needed, at which point the loader
+ * fills it in.
+ */
+class ColumnLoader : public Object {
+    public:
+        /** Subclass responsibility, appends every value of the given column,
+         *  which must be one of this loader's columns. Must be thread safe,
+         *  and must clear the column's loader once it is done. */
+        virtual void load(Column* col) = 0;
+
+        /** Subclass responsibility, the number of values of each column. */
+        virtual size_t length() = 0;
+};
 
 /**************************************************************************
  * Column ::
@@ -25,6 +46,161 @@ class StringColumn;
 class Column : public Object {
     public:
         char type_;
+        // Where the values come from while they haven't been loaded yet,
+        // nullptr once they are in memory
+        std::atomic<ColumnLoader*> loader_;
+
+        // Whether the values are known to be in ascending order, see
+        // DataFrame::sort. Changing the values through the column clears it;
+        // code that writes through get_fields() has to clear it too.
+        bool sorted_;
+
+        // Whether each value is present, or nullptr while every value is, so
+        // a column without missing values pays nothing for them. Int, bool
+        // and float columns keep it up to date; a string column marks its
+        // missing values itself (see StringColumn).
+        BoolArray* valid_;
+
+        Column() {
+            loader_ = nullptr;
+            sorted_ = false;
+            valid_ = nullptr;
+        }
+
+        /** Destructor */
+        ~Column() {
+            delete valid_;
+        }
+
+        /** Returns whether the value at idx is missing. */
+        virtual bool is_missing(size_t idx) {
+            return valid_ != nullptr && !valid_->get(idx);
+        }
+
+        /** Returns the bitmap of which values are present, nullptr if they
+         *  all are. It belongs to the column. */
+        BoolArray* get_validity() {
+            return valid_;
+        }
+
+        /** Returns the number of values that are not missing. */
+        virtual size_t count_present() {
+            return valid_ == nullptr ? size() : valid_->count_true();
+        }
+
+        /** Returns roughly how many bytes the column's storage takes up. */
+        virtual size_t footprint() {
+            return valid_ == nullptr ? 0 : valid_->footprint();
+        }
+
+        /** Private function that records n more present values. */
+        void add_valid_(size_t n) {
+            if (valid_ != nullptr) valid_->append_fill(true, n);
+        }
+
+        /** Private function that records a missing value at the end of the
+         *  column, creating the bitmap if this is the first one. */
+        void add_missing_() {
+            if (valid_ == nullptr) {
+                valid_ = new BoolArray();
+                valid_->append_fill(true, size());
+            }
+            valid_->append(false);
+        }
+
+        /** Private function that records n missing values at the end of the
+         *  column, creating the bitmap if they are the first ones. */
+        void add_missing_(size_t n) {
+            if (valid_ == nullptr) {
+                valid_ = new BoolArray();
+                valid_->append_fill(true, size());
+            }
+            valid_->append_fill(false, n);
+        }
+
+        /** Private function that records that the value at idx is present. */
+        void set_valid_(size_t idx) {
+            if (valid_ != nullptr) valid_->set(true, idx);
+        }
+
+        /** Private function that records which values of other, about to be
+         *  appended to this column, are present. */
+        void add_validity_(Column* other) {
+            if (other->valid_ == nullptr) {
+                add_valid_(other->size());
+                return;
+            }
+            if (valid_ == nullptr) {
+                valid_ = new BoolArray();
+                valid_->append_fill(true, size());
+            }
+            valid_->append_all(other->valid_);
+        }
+
+        /** Private function that records which values of other, about to be
+         *  moved onto this column, are present, and leaves other with no
+         *  missing values. */
+        void move_validity_(Column* other) {
+            add_validity_(other);
+            delete other->valid_;
+            other->valid_ = nullptr;
+        }
+
+        /** Returns the words of the bitmap of present values that cover
+         *  storage chunk k of the values, nullptr if every value is present. */
+        const uint64_t* chunk_validity(size_t k) {
+            if (valid_ == nullptr) return nullptr;
+            // A storage chunk's words lie in a single chunk of the bitmap
+            size_t first = k * (ARRAY_CHUNK_SIZE / 64);
+            return valid_->chunk(first >> ARRAY_CHUNK_SHIFT) + (first & ARRAY_CHUNK_MASK);
+        }
+
+        /** Private function that copies the values of storage chunk k of vals
+         *  that are present to out, and returns how many there are. The
+         *  bitmap is read a word at a time: full words are copied as a block
+         *  and empty ones skipped. */
+        template <class T>
+        size_t present_(const T* vals, size_t k, size_t len, T* out) {
+            const uint64_t* words = chunk_validity(k);
+            size_t n = 0;
+            for (size_t w = 0; w < (len + 63) / 64; w++) {
+                uint64_t word = words[w];
+                if (word == ~(uint64_t)0) {
+                    memcpy(out + n, vals + w * 64, 64 * sizeof(T));
+                    n += 64;
+                    continue;
+                }
+                while (word != 0) {
+                    out[n++] = vals[w * 64 + __builtin_ctzll(word)];
+                    word &= word - 1;
+                }
+            }
+            return n;
+        }
+
+        /** Returns whether the values are known to be in ascending order. */
+        bool is_sorted() {
+            return sorted_;
+        }
+
+        /** Records whether the values are in ascending order. */
+        void set_sorted(bool sorted) {
+            sorted_ = sorted;
+        }
+
+        /** Loads the values of a lazily loaded column if that hasn't happened
+         *  yet. The other methods only see the values that are in memory. */
+        void materialize() {
+            ColumnLoader* loader = loader_.load(std::memory_order_acquire);
+            if (loader != nullptr) loader->load(this);
+        }
+
+        /** Returns the number of elements, including those of a lazily loaded
+         *  column that are still waiting to be loaded. */
+        size_t length() {
+            ColumnLoader* loader = loader_.load(std::memory_order_acquire);
+            return loader != nullptr ? loader->length() : size();
+        }
 
         /** Type converters: Return same column under its actual type, or
          *  nullptr if of the wrong type.  */
@@ -49,6 +225,23 @@ class Column : public Object {
         /** Appends a default value that represents a missing field */
         virtual void append_missing() = 0;
 
+        /** Appends n missing fields. */
+        virtual void fill_missing(size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                append_missing();
+            }
+        }
+
+        /** Appends a copy of every value of other, a column of the same type,
+         *  onto the end of this column. */
+        virtual void append_all(Column* other) = 0;
+
+        /** Moves every value of other, a column of the same type, onto the end
+         *  of this column and leaves other empty. Storage chunks are handed
+         *  over rather than copied whenever this column ends on a chunk
+         *  boundary. */
+        virtual void move_from(Column* other) = 0;
+
         /** Return the type of this column as a char: 'S', 'B', 'I' and 'F'. */
         char get_type() {
             return type_;
@@ -91,6 +284,8 @@ class IntColumn : public Column {
 
         /** Adds the given field to the end of the column. */
         void push_back(int val) {
+            sorted_ = false;
+            add_valid_(1);
             ints_->append(val);
         }
 
@@ -142,6 +337,8 @@ class IntColumn : public Column {
 
         /** Set value at idx. An out of bound idx is undefined.  */
         void set(size_t idx, int val) {
+            sorted_ = false;
+            set_valid_(idx);
             ints_->set(val, idx);
         }
 
@@ -150,6 +347,10 @@ class IntColumn : public Column {
             return ints_->size();
         }
 
+        size_t footprint() {
+            return Column::footprint() + ints_->footprint();
+        }
+
         /** Getter for this column's underlying array of fields. */
         IntArray* get_fields() {
             return ints_;
@@ -159,12 +360,125 @@ class IntColumn : public Column {
         Column* clone() {
             IntColumn* clone = new IntColumn();
             clone->get_fields()->append_all(ints_);
+            if (valid_ != nullptr) {
+                clone->valid_ = new BoolArray();
+                clone->valid_->append_all(valid_);
+            }
             return clone;
         }
 
-        /** Appends a default value that represents a missing field */
+        /** Appends a missing field, stored as a default value and marked
+         *  missing. */
         void append_missing() {
-            push_back(0);
+            sorted_ = false;
+            add_missing_();
+            ints_->append(0);
+        }
+
+        /** Appends n missing fields, marked missing in one pass over the
+         *  bitmap. */
+        void fill_missing(size_t n) {
+            sorted_ = false;
+            add_missing_(n);
+            ints_->append_zeros(n);
+        }
+
+        /** Appends a copy of the values of other, a chunk at a time. */
+        void append_all(Column* other) {
+            sorted_ = false;
+            other->materialize();
+            add_validity_(other);
+            ints_->append_all(other->as_int()->ints_);
+        }
+
+        /** Appends the n ints at vals. */
+        void append_all(const int* vals, size_t n) {
+            sorted_ = false;
+            add_valid_(n);
+            ints_->append_all(vals, n);
+        }
+
+        /** Moves the values of other onto the end of this column. */
+        void move_from(Column* other) {
+            sorted_ = false;
+            move_validity_(other);
+            ints_->take_chunks(other->as_int()->ints_);
+        }
+
+        /** Summarizes the values in storage chunk k into stats, leaving out
+         *  missing values. */
+        void chunk_stats(size_t k, ColumnStats* stats) {
+            if (valid_ == nullptr) {
+                Kernels::int_stats(ints_->chunk(k), ints_->chunk_length(k), stats);
+                return;
+            }
+            int* vals = new int[ARRAY_CHUNK_SIZE];
+            Kernels::int_stats(vals, present_(ints_->chunk(k), k, ints_->chunk_length(k), vals), stats);
+            delete[] vals;
+        }
+
+        /** Returns the count, sum, min, max, mean and variance of the column,
+         *  computed with the vectorized kernels. The caller must delete it. */
+        ColumnStats* stats() {
+            ColumnStats* res = new ColumnStats();
+            for (size_t k = 0; k < ints_->chunk_count(); k++) {
+                ColumnStats part;
+                chunk_stats(k, &part);
+                res->merge(&part);
+            }
+            return res;
+        }
+
+        /** Returns the exact sum of the column. */
+        long sum() {
+            long total = 0;
+            int* vals = valid_ == nullptr ? nullptr : new int[ARRAY_CHUNK_SIZE];
+            for (size_t k = 0; k < ints_->chunk_count(); k++) {
+                size_t len = ints_->chunk_length(k);
+                const int* chunk = ints_->chunk(k);
+                if (vals != nullptr) {
+                    len = present_(chunk, k, len, vals);
+                    chunk = vals;
+                }
+                if (len == 0) continue;
+                long part;
+                int min, max;
+                Kernels::int_summary(chunk, len, &part, &min, &max);
+                total += part;
+            }
+            delete[] vals;
+            return total;
+        }
+
+        /** Smallest and largest value, 0 for an empty column. */
+        int min() {
+            ColumnStats* st = stats();
+            int res = (int)st->min();
+            delete st;
+            return res;
+        }
+        int max() {
+            ColumnStats* st = stats();
+            int res = (int)st->max();
+            delete st;
+            return res;
+        }
+
+        /** Number of values that are not missing. */
+        size_t count() {
+            return count_present();
+        }
+
+        /** Mean and population variance of the values, 0 for an empty column. */
+        double mean() {
+            size_t n = count();
+            return n == 0 ? 0 : (double)sum() / n;
+        }
+        double variance() {
+            ColumnStats* st = stats();
+            double res = st->variance();
+            delete st;
+            return res;
         }
 };
  
@@ -210,6 +524,8 @@ class BoolColumn : public Column {
 
         /** Adds the given field to the end of this column. */
         void push_back(bool val) {
+            sorted_ = false;
+            add_valid_(1);
             bools_->append(val);
         }
 
@@ -255,6 +571,8 @@ class BoolColumn : public Column {
 
         /** Set value at idx. An out of bound idx is undefined.  */
         void set(size_t idx, bool val) {
+            sorted_ = false;
+            set_valid_(idx);
             bools_->set(val, idx);
         }
 
@@ -263,6 +581,10 @@ class BoolColumn : public Column {
             return bools_->size();
         }
 
+        size_t footprint() {
+            return Column::footprint() + bools_->footprint();
+        }
+
         /** Getter for this column's underlying array of fields. */
         BoolArray* get_fields() {
             return bools_;
@@ -272,12 +594,115 @@ class BoolColumn : public Column {
         Column* clone() {
             BoolColumn* clone = new BoolColumn();
             clone->get_fields()->append_all(bools_);
+            if (valid_ != nullptr) {
+                clone->valid_ = new BoolArray();
+                clone->valid_->append_all(valid_);
+            }
             return clone;
         }
 
-        /** Appends a default value that represents a missing field */
+        /** Appends a missing field, stored as a default value and marked
+         *  missing. */
         void append_missing() {
-            push_back(false);
+            sorted_ = false;
+            add_missing_();
+            bools_->append(false);
+        }
+
+        /** Appends n missing fields, marked missing in one pass over the
+         *  bitmap. */
+        void fill_missing(size_t n) {
+            sorted_ = false;
+            add_missing_(n);
+            bools_->append_fill(false, n);
+        }
+
+        /** Appends a copy of the values of other, a word at a time when this
+         *  column ends on a word boundary. */
+        void append_all(Column* other) {
+            sorted_ = false;
+            other->materialize();
+            add_validity_(other);
+            bools_->append_all(other->as_bool()->bools_);
+        }
+
+        /** Appends the n bools at vals. */
+        void append_all(const bool* vals, size_t n) {
+            sorted_ = false;
+            add_valid_(n);
+            bools_->append_all(vals, n);
+        }
+
+        /** Moves the values of other onto the end of this column. Bits are
+         *  copied a word at a time. */
+        void move_from(Column* other) {
+            sorted_ = false;
+            move_validity_(other);
+            BoolColumn* col = other->as_bool();
+            bools_->append_all(col->bools_);
+            delete col->bools_;
+            col->bools_ = new BoolArray();
+        }
+
+        /** Returns the number of true fields, counted a word at a time. */
+        size_t count_true() {
+            return bools_->count_true();
+        }
+
+        /** Returns a new column holding the elementwise AND of this column and
+         *  other, which must have the same size. */
+        BoolColumn* bitwise_and(BoolColumn* other) {
+            exit_if_not(other->size() == size(), "BoolColumns have different sizes.");
+            BoolColumn* res = new BoolColumn();
+            BoolArray* bits = res->get_fields();
+            bits->reserve(size());
+            BoolArray* other_bits = other->get_fields();
+            size_t remaining = size();
+            for (size_t w = 0; w < bools_->word_count(); w++) {
+                size_t nbits = remaining < 64 ? remaining : 64;
+                bits->append_word(bools_->get_word(w) & other_bits->get_word(w), nbits);
+                remaining -= nbits;
+            }
+            return res;
+        }
+
+        /** Returns a new column holding the elementwise OR of this column and
+         *  other, which must have the same size. */
+        BoolColumn* bitwise_or(BoolColumn* other) {
+            exit_if_not(other->size() == size(), "BoolColumns have different sizes.");
+            BoolColumn* res = new BoolColumn();
+            BoolArray* bits = res->get_fields();
+            bits->reserve(size());
+            BoolArray* other_bits = other->get_fields();
+            size_t remaining = size();
+            for (size_t w = 0; w < bools_->word_count(); w++) {
+                size_t nbits = remaining < 64 ? remaining : 64;
+                bits->append_word(bools_->get_word(w) | other_bits->get_word(w), nbits);
+                remaining -= nbits;
+            }
+            return res;
+        }
+
+        /** Returns a new column holding the negation of every field. */
+        BoolColumn* bitwise_not() {
+            BoolColumn* res = new BoolColumn();
+            BoolArray* bits = res->get_fields();
+            bits->reserve(size());
+            size_t remaining = size();
+            for (size_t w = 0; w < bools_->word_count(); w++) {
+                size_t nbits = remaining < 64 ? remaining : 64;
+                // Keep the bits past the end zero
+                uint64_t mask = nbits == 64 ? ~(uint64_t)0 : ((uint64_t)1 << nbits) - 1;
+                bits->append_word(~bools_->get_word(w) & mask, nbits);
+                remaining -= nbits;
+            }
+            return res;
+        }
+
+        /** Returns an iterator over the indices of the true fields. The caller
+         *  must delete it, and must not modify the column while using it. */
+        SetBitIterator* set_indices() {
+            return new SetBitIterator(bools_);
         }
 };
  
@@ -329,6 +754,8 @@ class FloatColumn : public Column {
 
         /** Adds the given field to the end of this column. */
         void push_back(float val) {
+            sorted_ = false;
+            add_valid_(1);
             floats_->append(val);
         }
 
@@ -368,6 +795,8 @@ class FloatColumn : public Column {
 
         /** Set value at idx. An out of bound idx is undefined.  */
         void set(size_t idx, float val) {
+            sorted_ = false;
+            set_valid_(idx);
             floats_->set(val, idx);
         }
 
@@ -376,6 +805,10 @@ class FloatColumn : public Column {
             return floats_->size();
         }
 
+        size_t footprint() {
+            return Column::footprint() + floats_->footprint();
+        }
+
         /** Getter for this column's underlying array of fields. */
         FloatArray* get_fields() {
             return floats_;
@@ -385,45 +818,212 @@ class FloatColumn : public Column {
         Column* clone() {
             FloatColumn* clone = new FloatColumn();
             clone->get_fields()->append_all(floats_);
+            if (valid_ != nullptr) {
+                clone->valid_ = new BoolArray();
+                clone->valid_->append_all(valid_);
+            }
             return clone;
         }
 
-        /** Appends a default value that represents a missing field */
+        /** Appends a missing field, stored as a default value and marked
+         *  missing. */
         void append_missing() {
-            push_back(0.0f);
+            sorted_ = false;
+            add_missing_();
+            floats_->append(0.0f);
+        }
+
+        /** Appends n missing fields, marked missing in one pass over the
+         *  bitmap. */
+        void fill_missing(size_t n) {
+            sorted_ = false;
+            add_missing_(n);
+            floats_->append_zeros(n);
+        }
+
+        /** Appends a copy of the values of other, a chunk at a time. */
+        void append_all(Column* other) {
+            sorted_ = false;
+            other->materialize();
+            add_validity_(other);
+            floats_->append_all(other->as_float()->floats_);
+        }
+
+        /** Appends the n floats at vals. */
+        void append_all(const float* vals, size_t n) {
+            sorted_ = false;
+            add_valid_(n);
+            floats_->append_all(vals, n);
+        }
+
+        /** Moves the values of other onto the end of this column. */
+        void move_from(Column* other) {
+            sorted_ = false;
+            move_validity_(other);
+            floats_->take_chunks(other->as_float()->floats_);
+        }
+
+        /** Summarizes the values in storage chunk k into stats, leaving out
+         *  missing values. */
+        void chunk_stats(size_t k, ColumnStats* stats) {
+            if (valid_ == nullptr) {
+                Kernels::float_stats(floats_->chunk(k), floats_->chunk_length(k), stats);
+                return;
+            }
+            float* vals = new float[ARRAY_CHUNK_SIZE];
+            Kernels::float_stats(vals, present_(floats_->chunk(k), k, floats_->chunk_length(k), vals), stats);
+            delete[] vals;
+        }
+
+        /** Returns the count, sum, min, max, mean and variance of the column,
+         *  computed with the vectorized kernels. The caller must delete it. */
+        ColumnStats* stats() {
+            ColumnStats* res = new ColumnStats();
+            for (size_t k = 0; k < floats_->chunk_count(); k++) {
+                ColumnStats part;
+                chunk_stats(k, &part);
+                res->merge(&part);
+            }
+            return res;
+        }
+
+        /** Returns the sum of the column, accumulated in double. */
+        double sum() {
+            double total = 0;
+            float* vals = valid_ == nullptr ? nullptr : new float[ARRAY_CHUNK_SIZE];
+            for (size_t k = 0; k < floats_->chunk_count(); k++) {
+                size_t len = floats_->chunk_length(k);
+                const float* chunk = floats_->chunk(k);
+                if (vals != nullptr) {
+                    len = present_(chunk, k, len, vals);
+                    chunk = vals;
+                }
+                if (len == 0) continue;
+                double part;
+                float min, max;
+                Kernels::float_summary(chunk, len, &part, &min, &max);
+                total += part;
+            }
+            delete[] vals;
+            return total;
+        }
+
+        /** Smallest and largest value, 0 for an empty column. */
+        float min() {
+            ColumnStats* st = stats();
+            float res = (float)st->min();
+            delete st;
+            return res;
+        }
+        float max() {
+            ColumnStats* st = stats();
+            float res = (float)st->max();
+            delete st;
+            return res;
+        }
+
+        /** Number of values that are not missing. */
+        size_t count() {
+            return count_present();
+        }
+
+        /** Mean and population variance of the values, 0 for an empty column. */
+        double mean() {
+            size_t n = count();
+            return n == 0 ? 0 : sum() / n;
+        }
+        double variance() {
+            ColumnStats* st = stats();
+            double res = st->variance();
+            delete st;
+            return res;
         }
 };
  
+/*************************************************************************
+ * ArenaString::
+ * A String whose characters belong to a StringColumn's arena, so deleting
+ * it leaves them alone. It can be pointed at another field at any time,
+ * which makes it a reusable view of a column's strings.
+ */
+class ArenaString : public String {
+    public:
+        /** Builds an empty view, pointed at a field with point_to. */
+        ArenaString() : String(true, const_cast<char*>(""), 0) { }
+
+        ArenaString(char* chars, size_t len) : String(true, chars, len) { }
+
+        ~ArenaString() {
+            cstr_ = nullptr;
+        }
+
+        /** Points this view at the given null-terminated characters. */
+        void point_to(const char* chars, size_t len) {
+            cstr_ = const_cast<char*>(chars);
+            size_ = len;
+        }
+};
+
 /*************************************************************************
  * StringColumn::
- * Holds string pointers. The strings are external.  Nullptr is a valid
- * value.
+ * Holds strings. Nullptr is a valid value. The characters of every string
+ * are copied into one arena (see CharArena) and each field is an offset
+ * and a size, so adding a field allocates nothing but arena blocks.
+ *
+ * A column with few distinct values can be dictionary encoded (see
+ * encode_dictionary). Each distinct value is then stored once and the
+ * fields are integer codes into that dictionary.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
  */
 class StringColumn : public Column {
     public:
-        Array* strings_;
-        
+        CharArena* chars_;
+        // Arena offset and size of each field, or of each dictionary entry
+        // when the column is dictionary encoded. A size of -1 is a missing
+        // field.
+        SizeArray* offsets_;
+        IntArray* sizes_;
+        // Dictionary code of each field, -1 for a missing field, and the code
+        // of each dictionary entry; both nullptr unless dictionary encoded
+        IntArray* codes_;
+        StringMap* dict_;
+
         /** Constructs an empty StringColumn */
         StringColumn() {
-            strings_ = new Array();
-            type_ = 'S';
+            init_();
         }
 
-        /** Constructs a StringColumn and initializes it with the given strings. */
+        /** Constructs a StringColumn and initializes it with copies of the
+         *  given strings. */
         StringColumn(int n, ...) {
-            strings_ = new Array();
-            type_ = 'S';
+            init_();
             va_list vl;
             va_start(vl, n);
             for (int i = 0; i < n; i++) {
-                strings_->append(va_arg(vl, String*));
+                push_back(va_arg(vl, String*));
             }
             va_end(vl);
         }
 
         /** Destructor */
         ~StringColumn() {
-            delete strings_;
+            delete codes_;
+            delete dict_;
+            delete sizes_;
+            delete offsets_;
+            delete chars_;
+        }
+
+        /** Private function that sets up an empty plain column. */
+        void init_() {
+            chars_ = new CharArena();
+            offsets_ = new SizeArray();
+            sizes_ = new IntArray();
+            codes_ = nullptr;
+            dict_ = nullptr;
+            type_ = 'S';
         }
 
         /** Does nothing because an integer cannot be added to this column. */
@@ -444,9 +1044,25 @@ class StringColumn : public Column {
             return;
         }
 
-        /** Adds the given field to this column. */
+        /** Adds a copy of the given field to this column; the caller keeps
+         *  ownership of val. */
         void push_back(String* val) {
-            strings_->append(val);
+            if (val == nullptr) {
+                append_missing();
+            } else {
+                push_back_chars(val->c_str(), val->size());
+            }
+        }
+
+        /** Adds the len characters at chars to this column as one field. */
+        void push_back_chars(const char* chars, size_t len) {
+            sorted_ = false;
+            if (codes_ != nullptr) {
+                codes_->append(intern_(chars, len));
+            } else {
+                offsets_->append(chars_->add(chars, len));
+                sizes_->append(len);
+            }
         }
 
         /** Returns nullptr because this is not an IntColumn. */
@@ -472,35 +1088,274 @@ class StringColumn : public Column {
             return this;
         }
 
-        /** Returns the string at idx; undefined on invalid idx.*/
+        /** Returns whether the field at idx is missing. */
+        bool is_missing(size_t idx) {
+            return entry_(idx) < 0;
+        }
+
+        /** Returns the number of fields that are not missing. */
+        size_t count_present() {
+            size_t n = 0;
+            for (size_t i = 0; i < size(); i++) {
+                if (entry_(i) >= 0) n++;
+            }
+            return n;
+        }
+
+        /** Private function that returns the index into offsets_ and sizes_
+         *  of the field at idx, or -1 if it is missing. */
+        ssize_t entry_(size_t idx) {
+            if (codes_ != nullptr) return codes_->get(idx);
+            return sizes_->get(idx) < 0 ? -1 : idx;
+        }
+
+        /** Returns the characters of the field at idx, null-terminated, or
+         *  nullptr if it is missing. They belong to the column. */
+        const char* get_chars(size_t idx) {
+            ssize_t entry = entry_(idx);
+            return entry < 0 ? nullptr : chars_->at(offsets_->get(entry));
+        }
+
+        /** Returns the number of characters of the field at idx, or -1 if it
+         *  is missing. */
+        int get_size(size_t idx) {
+            ssize_t entry = entry_(idx);
+            return entry < 0 ? -1 : sizes_->get(entry);
+        }
+
+        /** Points the given view at the string at idx and returns it, or
+         *  returns nullptr if the field is missing; undefined on invalid idx.
+         *  Nothing is copied, allocated or locked, so threads can read the
+         *  column at once through views of their own. The view stays valid
+         *  until the field is set or the column is changed by
+         *  encode_dictionary or move_from. */
+        String* get(size_t idx, ArenaString* view) {
+            ssize_t entry = entry_(idx);
+            if (entry < 0) return nullptr;
+            view->point_to(chars_->at(offsets_->get(entry)), sizes_->get(entry));
+            return view;
+        }
+
+        /** Returns a copy of the string at idx, or nullptr if the field is
+         *  missing; undefined on invalid idx. The copy belongs to the caller,
+         *  use get(idx, view) to read strings without copying them. */
         String* get(size_t idx) {
-            return dynamic_cast<String*>(strings_->get(idx));
+            ssize_t entry = entry_(idx);
+            if (entry < 0) return nullptr;
+            return new String(chars_->at(offsets_->get(entry)), sizes_->get(entry));
         }
 
-        /** Acquire ownership of the string.  Out of bound idx is undefined. */
+        /** Sets the field at idx to a copy of val; the caller keeps ownership
+         *  of val. Out of bound idx is undefined. */
         void set(size_t idx, String* val) {
-            strings_->set(val, idx);
+            sorted_ = false;
+            if (codes_ != nullptr) {
+                codes_->set(val == nullptr ? -1 : intern_(val->c_str(), val->size()), idx);
+            } else if (val == nullptr) {
+                sizes_->set(-1, idx);
+            } else {
+                offsets_->set(chars_->add(val->c_str(), val->size()), idx);
+                sizes_->set(val->size(), idx);
+            }
         }
 
         /** Returns the number of fields in this StringColumn */
         size_t size() {
-            return strings_->size();
+            return codes_ != nullptr ? codes_->size() : sizes_->size();
         }
 
-        /** Getter for this column's underlying array of fields. */
-        Array* get_fields() {
-            return strings_;
+        size_t footprint() {
+            size_t bytes = chars_->footprint() + offsets_->footprint() + sizes_->footprint();
+            if (codes_ != nullptr) {
+                bytes += codes_->footprint();
+                bytes += dict_->capacity_ * (sizeof(char*) + 3 * sizeof(size_t));
+            }
+            return bytes;
         }
 
-        /** Returns a clone of this StringColumn. */
+        /** Returns a clone of this StringColumn, which is dictionary encoded
+         *  if this column is. */
         Column* clone() {
             StringColumn* clone = new StringColumn();
-            clone->get_fields()->append_all(strings_);
+            if (codes_ != nullptr) clone->encode_dictionary(dictionary_size());
+            clone->append_all_(this);
             return clone;
         }
 
         /** Appends a default value that represents a missing field */
         void append_missing() {
-            push_back(nullptr);
+            sorted_ = false;
+            if (codes_ != nullptr) {
+                codes_->append(-1);
+            } else {
+                offsets_->append(0);
+                sizes_->append(-1);
+            }
+        }
+
+        /** Private function that appends a copy of every field of other. */
+        void append_all_(StringColumn* other) {
+            for (size_t i = 0; i < other->size(); i++) {
+                ssize_t entry = other->entry_(i);
+                if (entry < 0) {
+                    append_missing();
+                } else {
+                    push_back_chars(other->chars_->at(other->offsets_->get(entry)),
+                                    other->sizes_->get(entry));
+                }
+            }
+        }
+
+        /** Appends a copy of the values of other. */
+        void append_all(Column* other) {
+            other->materialize();
+            append_all_(other->as_string());
+        }
+
+        /** Appends copies of the n Strings at vals, where nullptr is a
+         *  missing field. */
+        void append_all(String** vals, size_t n) {
+            if (codes_ != nullptr) {
+                codes_->reserve(codes_->size() + n);
+            } else {
+                offsets_->reserve(offsets_->size() + n);
+                sizes_->reserve(sizes_->size() + n);
+            }
+            for (size_t i = 0; i < n; i++) {
+                push_back(vals[i]);
+            }
+        }
+
+        /** Moves the values of other onto the end of this column. When
+         *  neither column is dictionary encoded, other's arena blocks are
+         *  handed over and only the offsets are adjusted. */
+        void move_from(Column* other) {
+            sorted_ = false;
+            StringColumn* strings = other->as_string();
+            if (codes_ != nullptr || strings->codes_ != nullptr) {
+                append_all_(strings);
+            } else {
+                size_t start = size();
+                size_t base = chars_->take_blocks(strings->chars_);
+                offsets_->take_chunks(strings->offsets_);
+                sizes_->take_chunks(strings->sizes_);
+                for (size_t k = start >> ARRAY_CHUNK_SHIFT; k < offsets_->chunk_count(); k++) {
+                    size_t* offsets = offsets_->chunk(k);
+                    size_t from = k == (start >> ARRAY_CHUNK_SHIFT) ? start & ARRAY_CHUNK_MASK : 0;
+                    for (size_t i = from; i < offsets_->chunk_length(k); i++) {
+                        offsets[i] += base;
+                    }
+                }
+            }
+            delete strings->chars_;
+            delete strings->offsets_;
+            delete strings->sizes_;
+            delete strings->codes_;
+            delete strings->dict_;
+            strings->init_();
+        }
+
+        /** Private function that returns the dictionary code of the given
+         *  characters, adding them to the dictionary if they are new. */
+        int intern_(const char* chars, size_t len) {
+            size_t code;
+            if (!dict_->get(chars, len, &code)) {
+                code = sizes_->size();
+                size_t offset = chars_->add(chars, len);
+                offsets_->append(offset);
+                sizes_->append(len);
+                // The key is the arena's copy, which never moves
+                dict_->put(chars_->at(offset), len, code);
+            }
+            return code;
+        }
+
+        /** Dictionary encodes this column if it has at most max_codes
+         *  distinct values, and returns whether it is now encoded. Values
+         *  added later are encoded too, however many there are. Views
+         *  previously pointed at its fields by get() become invalid. */
+        bool encode_dictionary(size_t max_codes) {
+            if (codes_ != nullptr) return true;
+            StringColumn encoded;
+            encoded.codes_ = new IntArray();
+            encoded.dict_ = new StringMap();
+            encoded.codes_->reserve(size());
+            for (size_t i = 0; i < size(); i++) {
+                if (sizes_->get(i) < 0) {
+                    encoded.codes_->append(-1);
+                    continue;
+                }
+                encoded.push_back_chars(chars_->at(offsets_->get(i)), sizes_->get(i));
+                if (encoded.dict_->size() > max_codes) return false;
+            }
+            swap_(&encoded.chars_, &chars_);
+            swap_(&encoded.offsets_, &offsets_);
+            swap_(&encoded.sizes_, &sizes_);
+            swap_(&encoded.codes_, &codes_);
+            swap_(&encoded.dict_, &dict_);
+            return true;
+        }
+
+        /** Private function that swaps two pointers. */
+        template <class T>
+        static void swap_(T** a, T** b) {
+            T* tmp = *a;
+            *a = *b;
+            *b = tmp;
+        }
+
+        /** Returns whether this column is dictionary encoded. */
+        bool is_dictionary() {
+            return codes_ != nullptr;
+        }
+
+        /** Returns the number of distinct values of a dictionary encoded
+         *  column. */
+        size_t dictionary_size() {
+            assert(codes_ != nullptr);
+            return sizes_->size();
+        }
+
+        /** Returns the dictionary code of the field at idx, or -1 if it is
+         *  missing, of a dictionary encoded column. Equal fields have equal
+         *  codes. */
+        int get_code(size_t idx) {
+            assert(codes_ != nullptr);
+            return codes_->get(idx);
+        }
+
+        /** Returns a new column that is true for every field equal to the len
+         *  characters at chars. A dictionary encoded column looks the value
+         *  up once and then compares codes. */
+        BoolColumn* equal_to(const char* chars, size_t len) {
+            BoolColumn* res = new BoolColumn();
+            BoolArray* bits = res->get_fields();
+            bits->reserve(size());
+            size_t code = 0;
+            bool known = codes_ != nullptr && dict_->get(chars, len, &code);
+            for (size_t start = 0; start < size(); start += 64) {
+                size_t nbits = size() - start < 64 ? size() - start : 64;
+                uint64_t word = 0;
+                if (codes_ != nullptr) {
+                    if (known) {
+                        for (size_t i = 0; i < nbits; i++) {
+                            word |= (uint64_t)(codes_->get(start + i) == (int)code) << i;
+                        }
+                    }
+                } else {
+                    for (size_t i = 0; i < nbits; i++) {
+                        size_t idx = start + i;
+                        word |= (uint64_t)(sizes_->get(idx) == (int)len &&
+                                           memcmp(chars_->at(offsets_->get(idx)), chars, len) == 0) << i;
+                    }
+                }
+                bits->append_word(word, nbits);
+            }
+            return res;
         }
-};
\ No newline at end of file
+
+        /** Returns a new column that is true for every field equal to val. */
+        BoolColumn* equal_to(String* val) {
+            return equal_to(val->c_str(), val->size());
+        }
+};
@@ -0,0 +1,406 @@
+//lang::CwC
+
+#pragma once
+
+#include "column.h"
+#include "int_map.h"
+#include "string_map.h"
+#include "thread.h"
+#include <float.h>
+
+// The aggregates DataFrame::group_by computes per group: the number of rows,
+// and the sum, smallest, largest and mean value of an int or float column
+#define AGG_COUNT 'C'
+#define AGG_SUM 'S'
+#define AGG_MIN 'N'
+#define AGG_MAX 'X'
+#define AGG_MEAN 'M'
+
+/*************************************************************************
+ * GroupTable::
+ * The groups of a group-by: a hash table from the int or string keys of the
+ * key column to dense group numbers, and per group the key, the number of
+ * rows, the first row it was seen in, and the sum, min, max and number of
+ * present values of each value column. Missing keys form a group of their
+ * own. The per-group state is kept in flat arrays indexed by group number,
+ * so the hash lookup is the only indirection per row. String keys point into
+ * the key column and are not copied.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class GroupTable : public Object {
+    public:
+        // 'I' or 'S', and the index for that type of key
+        char key_type_;
+        IntMap* int_index_;
+        StringMap* string_index_;
+        // The group of the missing key, SIZE_MAX until it is seen
+        size_t missing_;
+        size_t nvals_;
+        // Number of groups and the number the arrays have space for
+        size_t size_;
+        size_t capacity_;
+        // Per group: the key, as an int or as characters (nullptr for the
+        // missing key), the number of rows, and the first of them
+        int* int_keys_;
+        const char** key_chars_;
+        size_t* key_lens_;
+        size_t* counts_;
+        size_t* firsts_;
+        // Per group, per value column: the sum, min, max and number of
+        // present values
+        double* accs_;
+
+        /** Creates a table with no groups for keys of the given type and
+         *  nvals value columns. */
+        GroupTable(char key_type, size_t nvals) {
+            key_type_ = key_type;
+            int_index_ = key_type == 'I' ? new IntMap() : nullptr;
+            string_index_ = key_type == 'S' ? new StringMap() : nullptr;
+            missing_ = SIZE_MAX;
+            nvals_ = nvals;
+            size_ = 0;
+            capacity_ = 16;
+            int_keys_ = new int[capacity_];
+            key_chars_ = new const char*[capacity_];
+            key_lens_ = new size_t[capacity_];
+            counts_ = new size_t[capacity_];
+            firsts_ = new size_t[capacity_];
+            accs_ = new double[capacity_ * nvals_ * 4];
+        }
+
+        /** Destructor, the key characters are external. */
+        ~GroupTable() {
+            delete int_index_;
+            delete string_index_;
+            delete[] int_keys_;
+            delete[] key_chars_;
+            delete[] key_lens_;
+            delete[] counts_;
+            delete[] firsts_;
+            delete[] accs_;
+        }
+
+        /** Private function that doubles the space for groups. */
+        void grow_() {
+            size_t capacity = capacity_ * 2;
+            int* int_keys = new int[capacity];
+            const char** key_chars = new const char*[capacity];
+            size_t* key_lens = new size_t[capacity];
+            size_t* counts = new size_t[capacity];
+            size_t* firsts = new size_t[capacity];
+            double* accs = new double[capacity * nvals_ * 4];
+            memcpy(int_keys, int_keys_, size_ * sizeof(int));
+            memcpy(key_chars, key_chars_, size_ * sizeof(const char*));
+            memcpy(key_lens, key_lens_, size_ * sizeof(size_t));
+            memcpy(counts, counts_, size_ * sizeof(size_t));
+            memcpy(firsts, firsts_, size_ * sizeof(size_t));
+            memcpy(accs, accs_, size_ * nvals_ * 4 * sizeof(double));
+            delete[] int_keys_;
+            delete[] key_chars_;
+            delete[] key_lens_;
+            delete[] counts_;
+            delete[] firsts_;
+            delete[] accs_;
+            int_keys_ = int_keys;
+            key_chars_ = key_chars;
+            key_lens_ = key_lens;
+            counts_ = counts;
+            firsts_ = firsts;
+            accs_ = accs;
+            capacity_ = capacity;
+        }
+
+        /** Private function that adds an empty group first seen in the given
+         *  row and returns its number. */
+        size_t add_group_(size_t row) {
+            if (size_ == capacity_) grow_();
+            size_t g = size_++;
+            counts_[g] = 0;
+            firsts_[g] = row;
+            double* acc = &accs_[g * nvals_ * 4];
+            for (size_t v = 0; v < nvals_; v++) {
+                acc[4 * v] = 0;
+                acc[4 * v + 1] = DBL_MAX;
+                acc[4 * v + 2] = -DBL_MAX;
+                acc[4 * v + 3] = 0;
+            }
+            return g;
+        }
+
+        /** Private function that makes row the first row of group g if it
+         *  comes before it. Workers steal chunks out of order, so a table
+         *  can see a group's rows after later ones. Returns g. */
+        size_t seen_(size_t g, size_t row) {
+            if (row < firsts_[g]) firsts_[g] = row;
+            return g;
+        }
+
+        /** Returns the group of the given int key, adding it if this is its
+         *  first row. */
+        size_t int_group(int key, size_t row) {
+            size_t g;
+            if (int_index_->get(key, &g)) return seen_(g, row);
+            g = add_group_(row);
+            int_keys_[g] = key;
+            int_index_->put(key, g);
+            return g;
+        }
+
+        /** Returns the group of the missing key, adding it if this is its
+         *  first row. */
+        size_t missing_group(size_t row) {
+            if (missing_ == SIZE_MAX) {
+                missing_ = add_group_(row);
+                int_keys_[missing_] = 0;
+                key_chars_[missing_] = nullptr;
+                key_lens_[missing_] = 0;
+            }
+            return seen_(missing_, row);
+        }
+
+        /** Returns the group of the given string key, nullptr if it is
+         *  missing, adding it if this is its first row. */
+        size_t string_group(const char* chars, size_t len, size_t row) {
+            size_t g;
+            if (chars == nullptr) return missing_group(row);
+            if (string_index_->get(chars, len, &g)) return seen_(g, row);
+            g = add_group_(row);
+            key_chars_[g] = chars;
+            key_lens_[g] = len;
+            string_index_->put(chars, len, g);
+            return g;
+        }
+
+        /** Folds val, a present value, into value column v of group g. */
+        void add(size_t g, size_t v, double val) {
+            double* acc = &accs_[(g * nvals_ + v) * 4];
+            acc[0] += val;
+            if (val < acc[1]) acc[1] = val;
+            if (val > acc[2]) acc[2] = val;
+            acc[3]++;
+        }
+
+        /** Folds every group of other, a table with the same key type and
+         *  value columns, into this table. */
+        void merge(GroupTable* other) {
+            for (size_t h = 0; h < other->size_; h++) {
+                size_t g;
+                if (h == other->missing_) {
+                    g = missing_group(other->firsts_[h]);
+                } else if (key_type_ == 'I') {
+                    g = int_group(other->int_keys_[h], other->firsts_[h]);
+                } else {
+                    g = string_group(other->key_chars_[h], other->key_lens_[h], other->firsts_[h]);
+                }
+                counts_[g] += other->counts_[h];
+                double* acc = &accs_[g * nvals_ * 4];
+                double* from = &other->accs_[h * nvals_ * 4];
+                for (size_t v = 0; v < nvals_; v++) {
+                    acc[4 * v] += from[4 * v];
+                    if (from[4 * v + 1] < acc[4 * v + 1]) acc[4 * v + 1] = from[4 * v + 1];
+                    if (from[4 * v + 2] > acc[4 * v + 2]) acc[4 * v + 2] = from[4 * v + 2];
+                    acc[4 * v + 3] += from[4 * v + 3];
+                }
+            }
+        }
+
+        /** Returns the number of groups. */
+        size_t size() {
+            return size_;
+        }
+
+        /** Returns whether value column v has a present value in group g. */
+        bool has_values(size_t g, size_t v) {
+            return accs_[(g * nvals_ + v) * 4 + 3] > 0;
+        }
+
+        /** Returns the value of the given aggregate of value column v of
+         *  group g, counting every row for AGG_COUNT and only the present
+         *  values for the others. */
+        double aggregate(size_t g, size_t v, char agg) {
+            double* acc = &accs_[(g * nvals_ + v) * 4];
+            switch (agg) {
+                case AGG_COUNT:
+                    return (double)counts_[g];
+                case AGG_SUM:
+                    return acc[0];
+                case AGG_MIN:
+                    return acc[1];
+                case AGG_MAX:
+                    return acc[2];
+                case AGG_MEAN:
+                    return acc[0] / acc[3];
+                default:
+                    exit_if_not(false, "Invalid aggregate.");
+                    return 0;
+            }
+        }
+};
+
+/**
+ * Task that groups the rows of a key column, one storage chunk per unit of
+ * work, into one GroupTable per worker, so that the workers never share a
+ * table. Each chunk first looks up the group of every row, then folds each
+ * value column into the groups a column at a time. Missing values are found
+ * through the columns' bitmaps a word at a time, and a column with none
+ * skips them altogether. A view's rows are read through its selection, a
+ * value at a time.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class GroupByTask : public ChunkTask {
+    public:
+        // The int or string key column and the int or float value columns,
+        // external; a value column is nullptr when only its count is needed
+        Column* key_;
+        Column** vals_;
+        size_t nvals_;
+        size_t length_;
+        // The rows of the columns to group when grouping a view, one per row
+        // of the view, external; nullptr to group every row
+        SizeArray* rows_;
+        // Per worker: its table and the group of each row of its chunk
+        GroupTable** tables_;
+        size_t** groups_;
+
+        GroupByTask(Column* key, Column** vals, size_t nvals, size_t length, SizeArray* rows,
+                    size_t nchunks, size_t nworkers)
+            : ChunkTask(nchunks, nworkers) {
+            key_ = key;
+            vals_ = vals;
+            nvals_ = nvals;
+            length_ = length;
+            rows_ = rows;
+            tables_ = new GroupTable*[nworkers_];
+            groups_ = new size_t*[nworkers_];
+            for (size_t w = 0; w < nworkers_; w++) {
+                tables_[w] = new GroupTable(key->get_type(), nvals);
+                groups_[w] = new size_t[ARRAY_CHUNK_SIZE];
+            }
+        }
+
+        ~GroupByTask() {
+            for (size_t w = 0; w < nworkers_; w++) {
+                delete tables_[w];
+                delete[] groups_[w];
+            }
+            delete[] tables_;
+            delete[] groups_;
+        }
+
+        void run_chunk(size_t k, size_t worker) {
+            GroupTable* table = tables_[worker];
+            size_t* groups = groups_[worker];
+            size_t start = k << ARRAY_CHUNK_SHIFT;
+            size_t len = length_ - start < ARRAY_CHUNK_SIZE ? length_ - start : ARRAY_CHUNK_SIZE;
+            if (rows_ != nullptr) {
+                run_view_chunk_(table, groups, rows_->chunk(k), start, len);
+                return;
+            }
+            if (key_->get_type() == 'I') {
+                const int* keys = key_->as_int()->get_fields()->chunk(k);
+                const uint64_t* valid = key_->chunk_validity(k);
+                for (size_t i = 0; i < len; i++) {
+                    if (valid != nullptr && !((valid[i / 64] >> (i % 64)) & 1)) {
+                        groups[i] = table->missing_group(start + i);
+                    } else {
+                        groups[i] = table->int_group(keys[i], start + i);
+                    }
+                }
+            } else {
+                StringColumn* keys = key_->as_string();
+                for (size_t i = 0; i < len; i++) {
+                    int size = keys->get_size(start + i);
+                    groups[i] = table->string_group(keys->get_chars(start + i),
+                                                    size < 0 ? 0 : size, start + i);
+                }
+            }
+            for (size_t i = 0; i < len; i++) {
+                table->counts_[groups[i]]++;
+            }
+            for (size_t v = 0; v < nvals_; v++) {
+                if (vals_[v] == nullptr) continue;
+                const uint64_t* valid = vals_[v]->chunk_validity(k);
+                if (vals_[v]->get_type() == 'I') {
+                    add_values_(table, groups, v, vals_[v]->as_int()->get_fields()->chunk(k), valid,
+                                len);
+                } else {
+                    add_values_(table, groups, v, vals_[v]->as_float()->get_fields()->chunk(k),
+                                valid, len);
+                }
+            }
+        }
+
+        /** Private function that groups the len rows of a view starting at
+         *  row start of the view, which are the given rows of the columns.
+         *  The rows are scattered, so each value is read on its own. */
+        void run_view_chunk_(GroupTable* table, size_t* groups, const size_t* rows, size_t start,
+                             size_t len) {
+            if (key_->get_type() == 'I') {
+                IntColumn* keys = key_->as_int();
+                for (size_t i = 0; i < len; i++) {
+                    if (keys->is_missing(rows[i])) {
+                        groups[i] = table->missing_group(start + i);
+                    } else {
+                        groups[i] = table->int_group(keys->get(rows[i]), start + i);
+                    }
+                }
+            } else {
+                StringColumn* keys = key_->as_string();
+                for (size_t i = 0; i < len; i++) {
+                    int size = keys->get_size(rows[i]);
+                    groups[i] = table->string_group(keys->get_chars(rows[i]),
+                                                    size < 0 ? 0 : size, start + i);
+                }
+            }
+            for (size_t i = 0; i < len; i++) {
+                table->counts_[groups[i]]++;
+            }
+            for (size_t v = 0; v < nvals_; v++) {
+                Column* col = vals_[v];
+                if (col == nullptr) continue;
+                for (size_t i = 0; i < len; i++) {
+                    if (col->is_missing(rows[i])) continue;
+                    if (col->get_type() == 'I') {
+                        table->add(groups[i], v, col->as_int()->get(rows[i]));
+                    } else {
+                        table->add(groups[i], v, col->as_float()->get(rows[i]));
+                    }
+                }
+            }
+        }
+
+        /** Private function that folds the len values of value column v of a
+         *  chunk into their groups, only those whose bit in valid is set
+         *  unless it is nullptr. */
+        template <class T>
+        static void add_values_(GroupTable* table, size_t* groups, size_t v, const T* vals,
+                                const uint64_t* valid, size_t len) {
+            if (valid == nullptr) {
+                for (size_t i = 0; i < len; i++) {
+                    table->add(groups[i], v, vals[i]);
+                }
+                return;
+            }
+            for (size_t w = 0; w < (len + 63) / 64; w++) {
+                uint64_t word = valid[w];
+                while (word != 0) {
+                    size_t i = w * 64 + __builtin_ctzll(word);
+                    table->add(groups[i], v, vals[i]);
+                    word &= word - 1;
+                }
+            }
+        }
+
+        /** Merges every worker's table into the first one and returns it.
+         *  It still belongs to this task. */
+        GroupTable* result() {
+            for (size_t w = 1; w < nworkers_; w++) {
+                tables_[0]->merge(tables_[w]);
+            }
+            return tables_[0];
+        }
+};
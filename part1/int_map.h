@@ -0,0 +1,114 @@
+#pragma once
+
+#include "object.h"
+#include <stdint.h>
+#include <assert.h>
+
+// Number of slots in a new IntMap; it doubles whenever it gets half full
+#define INITIAL_INT_MAP_CAPACITY 16
+
+/**
+ * A hash map from ints to sizes below 2^32 - 1, using open addressing with
+ * linear probing. Each slot is a single 64-bit word holding the key in the
+ * high half and the value plus one in the low half (0 for an empty slot), so
+ * a probe touches one word per slot and neighbouring slots share cache lines.
+ * Keys are hashed by Fibonacci hashing, which spreads consecutive keys apart.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class IntMap : public Object {
+    public:
+        uint64_t* slots_;
+        // Number of slots, always a power of two, and its log2
+        size_t capacity_;
+        size_t bits_;
+        // Number of keys
+        size_t size_;
+
+        /**
+         * Initialize an empty map.
+         */
+        IntMap() {
+            size_ = 0;
+            alloc_(INITIAL_INT_MAP_CAPACITY);
+        }
+
+        /**
+         * Destructor.
+         */
+        ~IntMap() {
+            delete[] slots_;
+        }
+
+        /**
+         * Private function that allocates capacity empty slots.
+         */
+        void alloc_(size_t capacity) {
+            capacity_ = capacity;
+            bits_ = 0;
+            while (((size_t)1 << bits_) < capacity_) bits_++;
+            slots_ = new uint64_t[capacity_];
+            for (size_t i = 0; i < capacity_; i++) {
+                slots_[i] = 0;
+            }
+        }
+
+        /**
+         * Private function that returns the slot holding the given key, or the
+         * empty slot where it would go.
+         */
+        size_t find_(int key) {
+            uint64_t high = (uint64_t)(uint32_t)key << 32;
+            size_t mask = capacity_ - 1;
+            size_t slot = (size_t)(((uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ULL) >> (64 - bits_));
+            while (slots_[slot] != 0) {
+                if ((slots_[slot] & 0xFFFFFFFF00000000ULL) == high) return slot;
+                slot = (slot + 1) & mask;
+            }
+            return slot;
+        }
+
+        /**
+         * Private function that doubles the number of slots and reinserts
+         * every key.
+         */
+        void grow_() {
+            uint64_t* slots = slots_;
+            size_t capacity = capacity_;
+            alloc_(capacity * 2);
+            for (size_t i = 0; i < capacity; i++) {
+                if (slots[i] == 0) continue;
+                slots_[find_((int)(slots[i] >> 32))] = slots[i];
+            }
+            delete[] slots;
+        }
+
+        // Looks up the given key. If it is present, stores its value in
+        // value and returns true.
+        bool get(int key, size_t* value) {
+            uint64_t slot = slots_[find_(key)];
+            if (slot == 0) return false;
+            *value = (size_t)(slot & 0xFFFFFFFF) - 1;
+            return true;
+        }
+
+        // Maps the given key to the given value, replacing any previous value.
+        void put(int key, size_t value) {
+            assert(value < 0xFFFFFFFF);
+            size_t slot = find_(key);
+            if (slots_[slot] == 0) {
+                if (2 * (size_ + 1) > capacity_) {
+                    grow_();
+                    slot = find_(key);
+                }
+                size_++;
+            }
+            slots_[slot] = ((uint64_t)(uint32_t)key << 32) | (uint64_t)(value + 1);
+        }
+
+        // Returns the number of keys.
+        size_t size() {
+            return size_;
+        }
+};
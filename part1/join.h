@@ -0,0 +1,412 @@
+//lang::CwC
+
+#pragma once
+
+#include "column.h"
+#include "int_map.h"
+#include "string_map.h"
+#include "thread.h"
+
+/*************************************************************************
+ * JoinTable::
+ * The build side of a hash join: the rows of an int or string key column,
+ * indexed by key. The rows are split by hash into a power of two number of
+ * partitions, each with its own open addressing index, so that the
+ * partitions can be built in parallel without sharing anything. An index
+ * maps a key to the first row holding it and next() chains each row to the
+ * following row with the same key, so the rows of a key come out in order.
+ * String keys are hashed like String::hash() and point into the key column.
+ * A missing key matches nothing. The table can be built over the rows of a
+ * view, which it then numbers by their position in the view.
+ *
+ * Building takes three passes, each run by a task below: PartitionTask
+ * hashes and counts the rows of each partition per storage chunk, and once
+ * plan() has turned the counts into positions, lists the rows grouped by
+ * partition; BuildTask then indexes every partition.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class JoinTable : public Object {
+    public:
+        // The key column, external, and its number of rows and chunks
+        Column* key_;
+        // The rows of the key column a view selects, external, one per row
+        // of the table; nullptr when the table has every row of the column
+        SizeArray* rows_;
+        size_t length_;
+        size_t nchunks_;
+        size_t npartitions_;
+        size_t pbits_;
+        // Per row: its hash, and the next row with the same key, SIZE_MAX
+        // for the last one
+        size_t* hashes_;
+        size_t* next_;
+        // Per chunk, per partition: the number of rows, then where the next
+        // one goes in order_
+        size_t* counts_;
+        // The rows grouped by partition, and where each partition starts
+        size_t* order_;
+        size_t* starts_;
+        // Per partition: the index of the first row of each key
+        IntMap** ints_;
+        StringMap** strings_;
+
+        /** Creates the table of the given key column, for building on
+         *  nworkers threads. It has length rows: those of the column, or
+         *  those listed in rows if it is not nullptr. */
+        JoinTable(Column* key, SizeArray* rows, size_t length, size_t nworkers) {
+            assert(length < 0xFFFFFFFF);
+            key_ = key;
+            rows_ = rows;
+            length_ = length;
+            nchunks_ = (length + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            pbits_ = 0;
+            while (nworkers > 1 && ((size_t)1 << pbits_) < 4 * nworkers) pbits_++;
+            npartitions_ = (size_t)1 << pbits_;
+            hashes_ = new size_t[length];
+            next_ = new size_t[length];
+            counts_ = new size_t[nchunks_ * npartitions_];
+            order_ = new size_t[length];
+            starts_ = new size_t[npartitions_ + 1];
+            ints_ = nullptr;
+            strings_ = nullptr;
+            if (key->get_type() == 'I') {
+                ints_ = new IntMap*[npartitions_];
+                for (size_t p = 0; p < npartitions_; p++) ints_[p] = new IntMap();
+            } else {
+                strings_ = new StringMap*[npartitions_];
+                for (size_t p = 0; p < npartitions_; p++) strings_[p] = new StringMap();
+            }
+        }
+
+        ~JoinTable() {
+            for (size_t p = 0; p < npartitions_; p++) {
+                if (ints_ != nullptr) delete ints_[p];
+                if (strings_ != nullptr) delete strings_[p];
+            }
+            delete[] ints_;
+            delete[] strings_;
+            delete[] hashes_;
+            delete[] next_;
+            delete[] counts_;
+            delete[] order_;
+            delete[] starts_;
+        }
+
+        /** Returns the hash of an int key, with its bits well mixed. */
+        static size_t hash_int(int key) {
+            uint64_t h = (uint32_t)key;
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 33;
+            h *= 0xC4CEB9FE1A85EC53ULL;
+            h ^= h >> 33;
+            return (size_t)h;
+        }
+
+        /** Returns the partition of a key with the given hash. It is taken
+         *  from the high bits of a product, which are independent of the
+         *  bits the indexes use to place the key. */
+        size_t partition(size_t hash) {
+            if (pbits_ == 0) return 0;
+            return (size_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ULL) >> (64 - pbits_));
+        }
+
+        /** Returns the row of the key column that holds the given row. */
+        size_t key_row(size_t row) {
+            return rows_ == nullptr ? row : rows_->get(row);
+        }
+
+        /** Returns the hash of the key of the given row of the key column,
+         *  which must not be missing. */
+        size_t hash_row(size_t row) {
+            if (ints_ != nullptr) return hash_int(key_->as_int()->get(row));
+            StringColumn* keys = key_->as_string();
+            return String::hash_chars(keys->get_chars(row), keys->get_size(row));
+        }
+
+        /** Turns the counts of the rows of each partition per chunk into the
+         *  position of each chunk's first row of that partition in order_. */
+        void plan() {
+            size_t pos = 0;
+            for (size_t p = 0; p < npartitions_; p++) {
+                starts_[p] = pos;
+                for (size_t k = 0; k < nchunks_; k++) {
+                    size_t count = counts_[k * npartitions_ + p];
+                    counts_[k * npartitions_ + p] = pos;
+                    pos += count;
+                }
+            }
+            starts_[npartitions_] = pos;
+        }
+
+        /** Returns the first row with the given int key and hash, SIZE_MAX
+         *  if there is none. */
+        size_t first(int key, size_t hash) {
+            size_t row;
+            return ints_[partition(hash)]->get(key, &row) ? row : SIZE_MAX;
+        }
+
+        /** Returns the first row with the given string key and hash, SIZE_MAX
+         *  if there is none or the key is nullptr. */
+        size_t first(const char* chars, size_t len, size_t hash) {
+            size_t row;
+            if (chars == nullptr) return SIZE_MAX;
+            return strings_[partition(hash)]->get(chars, len, &row) ? row : SIZE_MAX;
+        }
+
+        /** Returns the row after the given one with the same key, SIZE_MAX if
+         *  there is none. */
+        size_t next(size_t row) {
+            return next_[row];
+        }
+};
+
+/**
+ * Task that runs one of the two partitioning passes of a JoinTable, one
+ * storage chunk of its key column per unit of work: counting the rows of
+ * each partition, or listing them in order_ once the table is planned.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class PartitionTask : public ChunkTask {
+    public:
+        // The table being built, external
+        JoinTable* table_;
+        // Whether this is the listing pass
+        bool scatter_;
+
+        PartitionTask(JoinTable* table, bool scatter, size_t nworkers)
+            : ChunkTask(table->nchunks_, nworkers) {
+            table_ = table;
+            scatter_ = scatter;
+        }
+
+        void run_chunk(size_t k) {
+            size_t start = k << ARRAY_CHUNK_SHIFT;
+            size_t end = table_->length_ - start < ARRAY_CHUNK_SIZE ? table_->length_
+                                                                    : start + ARRAY_CHUNK_SIZE;
+            size_t* counts = &table_->counts_[k * table_->npartitions_];
+            size_t* hashes = table_->hashes_;
+            Column* key = table_->key_;
+            if (scatter_) {
+                bool missing = table_->strings_ != nullptr || key->get_validity() != nullptr;
+                for (size_t i = start; i < end; i++) {
+                    if (missing && key->is_missing(table_->key_row(i))) continue;
+                    table_->order_[counts[table_->partition(hashes[i])]++] = i;
+                }
+                return;
+            }
+            for (size_t p = 0; p < table_->npartitions_; p++) {
+                counts[p] = 0;
+            }
+            if (table_->rows_ != nullptr) {
+                // The rows of a view are scattered, so each key is read on its own
+                for (size_t i = start; i < end; i++) {
+                    size_t row = table_->key_row(i);
+                    if (key->is_missing(row)) continue;
+                    hashes[i] = table_->hash_row(row);
+                    counts[table_->partition(hashes[i])]++;
+                }
+            } else if (table_->ints_ != nullptr) {
+                const int* keys = key->as_int()->get_fields()->chunk(k);
+                const uint64_t* valid = key->chunk_validity(k);
+                for (size_t i = start; i < end; i++) {
+                    size_t j = i - start;
+                    if (valid != nullptr && !((valid[j / 64] >> (j % 64)) & 1)) continue;
+                    hashes[i] = JoinTable::hash_int(keys[j]);
+                    counts[table_->partition(hashes[i])]++;
+                }
+            } else {
+                StringColumn* keys = table_->key_->as_string();
+                for (size_t i = start; i < end; i++) {
+                    int size = keys->get_size(i);
+                    if (size < 0) continue;
+                    hashes[i] = String::hash_chars(keys->get_chars(i), size);
+                    counts[table_->partition(hashes[i])]++;
+                }
+            }
+        }
+};
+
+/**
+ * Task that indexes the rows of a planned and listed JoinTable, one
+ * partition per unit of work.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class BuildTask : public ChunkTask {
+    public:
+        // The table being built, external
+        JoinTable* table_;
+
+        BuildTask(JoinTable* table, size_t nworkers)
+            : ChunkTask(table->npartitions_, nworkers) {
+            table_ = table;
+        }
+
+        /** Indexes the rows of partition p. They are visited last to first,
+         *  so that each row is chained in front of the later ones. */
+        void run_chunk(size_t p) {
+            size_t* order = table_->order_;
+            size_t* next = table_->next_;
+            size_t head;
+            if (table_->ints_ != nullptr) {
+                IntMap* index = table_->ints_[p];
+                IntColumn* keys = table_->key_->as_int();
+                for (size_t j = table_->starts_[p + 1]; j > table_->starts_[p]; j--) {
+                    size_t row = order[j - 1];
+                    int key = keys->get(table_->key_row(row));
+                    next[row] = index->get(key, &head) ? head : SIZE_MAX;
+                    index->put(key, row);
+                }
+            } else {
+                StringMap* index = table_->strings_[p];
+                StringColumn* keys = table_->key_->as_string();
+                for (size_t j = table_->starts_[p + 1]; j > table_->starts_[p]; j--) {
+                    size_t row = order[j - 1];
+                    const char* chars = keys->get_chars(table_->key_row(row));
+                    size_t len = keys->get_size(table_->key_row(row));
+                    next[row] = index->get(chars, len, &head) ? head : SIZE_MAX;
+                    index->put(chars, len, row);
+                }
+            }
+        }
+};
+
+/**
+ * Task that probes a JoinTable with the rows of another key column of the
+ * same type, one storage chunk per unit of work. A chunk hashes all of its
+ * keys before looking any of them up, then lists the pairs of matching
+ * rows in order. For a left join, a row without a match is paired with
+ * SIZE_MAX. The rows are listed as rows of the two key columns, so probing
+ * with a view or probing a table built over one copies nothing.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ProbeTask : public ChunkTask {
+    public:
+        // The built table and the probing key column, external
+        JoinTable* table_;
+        Column* key_;
+        // The rows of the probing column a view selects, external, or
+        // nullptr to probe with every row
+        SizeArray* rows_;
+        size_t length_;
+        bool outer_;
+        // Per chunk: the matching rows of the probing and the table's column
+        SizeArray** lefts_;
+        SizeArray** rights_;
+        // Per worker: the hash of each row of its chunk
+        size_t** hashes_;
+
+        ProbeTask(JoinTable* table, Column* key, SizeArray* rows, size_t length, bool outer,
+                  size_t nchunks, size_t nworkers)
+            : ChunkTask(nchunks, nworkers) {
+            table_ = table;
+            key_ = key;
+            rows_ = rows;
+            length_ = length;
+            outer_ = outer;
+            lefts_ = new SizeArray*[nchunks];
+            rights_ = new SizeArray*[nchunks];
+            for (size_t k = 0; k < nchunks; k++) {
+                lefts_[k] = nullptr;
+                rights_[k] = nullptr;
+            }
+            hashes_ = new size_t*[nworkers_];
+            for (size_t w = 0; w < nworkers_; w++) {
+                hashes_[w] = new size_t[ARRAY_CHUNK_SIZE];
+            }
+        }
+
+        ~ProbeTask() {
+            for (size_t k = 0; k < nchunks_; k++) {
+                delete lefts_[k];
+                delete rights_[k];
+            }
+            for (size_t w = 0; w < nworkers_; w++) {
+                delete[] hashes_[w];
+            }
+            delete[] lefts_;
+            delete[] rights_;
+            delete[] hashes_;
+        }
+
+        /** Private function that pairs row i of the probing column with the
+         *  table's rows from the given first one on, or with SIZE_MAX for a
+         *  left join if there is none. */
+        void emit_(SizeArray* lefts, SizeArray* rights, size_t i, size_t row) {
+            if (row == SIZE_MAX && outer_) {
+                lefts->append(i);
+                rights->append(SIZE_MAX);
+            }
+            for (; row != SIZE_MAX; row = table_->next(row)) {
+                lefts->append(i);
+                rights->append(table_->key_row(row));
+            }
+        }
+
+        /** Private function that probes with the len rows of a view listed
+         *  in rows, reading each key on its own. */
+        void probe_view_(SizeArray* lefts, SizeArray* rights, const size_t* rows, size_t len) {
+            for (size_t i = 0; i < len; i++) {
+                size_t row = rows[i];
+                if (key_->is_missing(row)) {
+                    emit_(lefts, rights, row, SIZE_MAX);
+                } else if (key_->get_type() == 'I') {
+                    int key = key_->as_int()->get(row);
+                    emit_(lefts, rights, row, table_->first(key, JoinTable::hash_int(key)));
+                } else {
+                    StringColumn* keys = key_->as_string();
+                    const char* chars = keys->get_chars(row);
+                    size_t size = keys->get_size(row);
+                    emit_(lefts, rights, row,
+                          table_->first(chars, size, String::hash_chars(chars, size)));
+                }
+            }
+        }
+
+        void run_chunk(size_t k, size_t worker) {
+            size_t* hashes = hashes_[worker];
+            size_t start = k << ARRAY_CHUNK_SHIFT;
+            size_t len = length_ - start < ARRAY_CHUNK_SIZE ? length_ - start : ARRAY_CHUNK_SIZE;
+            SizeArray* lefts = new SizeArray();
+            SizeArray* rights = new SizeArray();
+            lefts->reserve(len);
+            rights->reserve(len);
+            if (rows_ != nullptr) {
+                probe_view_(lefts, rights, rows_->chunk(k), len);
+            } else if (key_->get_type() == 'I') {
+                const int* keys = key_->as_int()->get_fields()->chunk(k);
+                const uint64_t* valid = key_->chunk_validity(k);
+                for (size_t i = 0; i < len; i++) {
+                    hashes[i] = JoinTable::hash_int(keys[i]);
+                }
+                for (size_t i = 0; i < len; i++) {
+                    if (valid != nullptr && !((valid[i / 64] >> (i % 64)) & 1)) {
+                        emit_(lefts, rights, start + i, SIZE_MAX);
+                    } else {
+                        emit_(lefts, rights, start + i, table_->first(keys[i], hashes[i]));
+                    }
+                }
+            } else {
+                StringColumn* keys = key_->as_string();
+                for (size_t i = 0; i < len; i++) {
+                    int size = keys->get_size(start + i);
+                    hashes[i] = size < 0 ? 0 : String::hash_chars(keys->get_chars(start + i), size);
+                }
+                for (size_t i = 0; i < len; i++) {
+                    int size = keys->get_size(start + i);
+                    emit_(lefts, rights, start + i,
+                          table_->first(keys->get_chars(start + i), size < 0 ? 0 : size, hashes[i]));
+                }
+            }
+            lefts_[k] = lefts;
+            rights_[k] = rights;
+        }
+};
@@ -0,0 +1,97 @@
+// Lang::CwC
+#pragma once
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "object.h"
+
+/**
+ * A whole file mapped into memory. The mapping is private and copy-on-write:
+ * the bytes can be read (and patched) in place, and nothing is ever written
+ * back to the file. The mapping stays valid after the file is closed, until
+ * this object is deleted.
+ */
+class MappedFile : public Object {
+   public:
+    /** Start of the mapped bytes, nullptr for an empty file */
+    char* _data;
+    /** Size of the file in bytes */
+    size_t _size;
+
+    /**
+     * Maps the given open file.
+     * @param file The file to map. May be closed once the constructor returns
+     */
+    MappedFile(FILE* file) : Object() { _map(fileno(file)); }
+
+    /**
+     * Opens and maps the file at the given path. Terminates if it cannot be opened.
+     * @param path The path of the file
+     */
+    MappedFile(const char* path) : Object() {
+        int fd = open(path, O_RDONLY);
+        exit_if_not(fd >= 0, "Failed to open file");
+        _map(fd);
+        close(fd);
+    }
+
+    /**
+     * Destructor for MappedFile, unmaps the file
+     */
+    virtual ~MappedFile() {
+        if (_data != nullptr) {
+            munmap(_data, _size);
+        }
+    }
+
+    /**
+     * Maps the whole file behind the given descriptor.
+     * @param fd The file descriptor
+     */
+    virtual void _map(int fd) {
+        struct stat st;
+        exit_if_not(fstat(fd, &st) == 0, "Failed to stat file");
+        _size = st.st_size;
+        _data = nullptr;
+        if (_size == 0) {
+            return;
+        }
+        void* data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        exit_if_not(data != MAP_FAILED, "Failed to map file");
+        _data = static_cast<char*>(data);
+    }
+
+    /**
+     * @return The mapped bytes
+     */
+    virtual char* getData() { return _data; }
+
+    /**
+     * @return The size of the file in bytes
+     */
+    virtual size_t getSize() { return _size; }
+
+    /**
+     * Tells the kernel how the given byte range is going to be accessed (e.g.
+     * MADV_SEQUENTIAL). This is only a hint, failures are ignored.
+     * @param start The first byte of the range
+     * @param end One past the last byte of the range
+     * @param advice The madvise() advice
+     */
+    virtual void advise(size_t start, size_t end, int advice) {
+        if (_data == nullptr || end > _size) {
+            end = _size;
+        }
+        if (_data == nullptr || start >= end) {
+            return;
+        }
+        // madvise needs a page-aligned address
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t aligned = start - start % page;
+        madvise(_data + aligned, end - aligned, advice);
+    }
+};
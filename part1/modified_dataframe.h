@@ -7,7 +7,15 @@
 #include "schema.h"
 #include "column.h"
 #include "row.h"
-#include <thread>
+#include "thread.h"
+#include "group_by.h"
+#include "join.h"
+#include "sort.h"
+#include "predicate.h"
+#include <algorithm>
+
+// Number of rows in each unit of work handed out by pmap()
+#define PMAP_CHUNK_ROWS 65536
 
 /**
  * Fielder that prints each field.
@@ -50,6 +58,499 @@ class PrintRower : public Rower {
 
         void join_delete(Rower* other) { }
 };
+
+class DataFrame;
+
+/**
+ * Task run by the workers of a ThreadPool during DataFrame::pmap(). The rows
+ * are cut into fixed-size chunks, and each chunk is visited by its own Rower
+ * so that the results can be joined back in chunk order.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class PmapTask : public ChunkTask {
+    public:
+        DataFrame* df_;
+        // One Rower per chunk, external
+        Rower** rowers_;
+        size_t chunk_rows_;
+
+        PmapTask(DataFrame* df, Rower** rowers, size_t nchunks, size_t chunk_rows,
+                 size_t nworkers) : ChunkTask(nchunks, nworkers) {
+            df_ = df;
+            rowers_ = rowers;
+            chunk_rows_ = chunk_rows;
+        }
+
+        void run_chunk(size_t chunk);
+};
+
+/**
+ * Task that summarizes numeric columns in parallel. Every (column, storage
+ * chunk) pair is a unit of work, and the partial summaries are merged in
+ * order once all of them are done. For a view, a unit is a chunk of the
+ * view's rows, copied into a buffer for the kernels.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class StatsTask : public ChunkTask {
+    public:
+        // The int or float columns to summarize, external
+        Column** cols_;
+        size_t chunks_per_col_;
+        // One summary per (column, chunk), column-major
+        ColumnStats* parts_;
+        // The rows of a view, external, nullptr for every row
+        SizeArray* rows_;
+        size_t length_;
+
+        StatsTask(Column** cols, size_t ncols, size_t chunks_per_col, SizeArray* rows,
+                  size_t length, size_t nworkers)
+            : ChunkTask(ncols * chunks_per_col, nworkers) {
+            cols_ = cols;
+            chunks_per_col_ = chunks_per_col;
+            parts_ = new ColumnStats[ncols * chunks_per_col];
+            rows_ = rows;
+            length_ = length;
+        }
+
+        ~StatsTask() {
+            delete[] parts_;
+        }
+
+        void run_chunk(size_t chunk) {
+            Column* col = cols_[chunk / chunks_per_col_];
+            size_t k = chunk % chunks_per_col_;
+            if (rows_ != nullptr) {
+                view_stats_(col, k, &parts_[chunk]);
+            } else if (col->get_type() == 'I') {
+                static_cast<IntColumn*>(col)->chunk_stats(k, &parts_[chunk]);
+            } else {
+                static_cast<FloatColumn*>(col)->chunk_stats(k, &parts_[chunk]);
+            }
+        }
+
+        /** Summarizes chunk k of the view's rows of the given column, leaving
+         *  out missing values. */
+        void view_stats_(Column* col, size_t k, ColumnStats* stats) {
+            size_t start = k * ARRAY_CHUNK_SIZE;
+            size_t len = length_ - start < ARRAY_CHUNK_SIZE ? length_ - start : ARRAY_CHUNK_SIZE;
+            size_t n = 0;
+            if (col->get_type() == 'I') {
+                IntColumn* ints = col->as_int();
+                int* vals = new int[len];
+                for (size_t i = 0; i < len; i++) {
+                    size_t row = rows_->get(start + i);
+                    if (!ints->is_missing(row)) vals[n++] = ints->get(row);
+                }
+                Kernels::int_stats(vals, n, stats);
+                delete[] vals;
+            } else {
+                FloatColumn* floats = col->as_float();
+                float* vals = new float[len];
+                for (size_t i = 0; i < len; i++) {
+                    size_t row = rows_->get(start + i);
+                    if (!floats->is_missing(row)) vals[n++] = floats->get(row);
+                }
+                Kernels::float_stats(vals, n, stats);
+                delete[] vals;
+            }
+        }
+
+        /** Merges the partial summaries of the i-th column into a new
+         *  ColumnStats owned by the caller. */
+        ColumnStats* result(size_t i) {
+            ColumnStats* res = new ColumnStats();
+            for (size_t k = 0; k < chunks_per_col_; k++) {
+                res->merge(&parts_[i * chunks_per_col_ + k]);
+            }
+            return res;
+        }
+};
+
+/**
+ * Task that computes the running sum of the rows of some int and float
+ * columns, one storage chunk per unit of work. It runs in two passes: the
+ * first adds up each chunk, and once the chunk totals have been turned into
+ * the sum of everything before each chunk, the second writes every chunk's
+ * running sums starting from that offset.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class PrefixSumTask : public ChunkTask {
+    public:
+        // The int or float columns to add up, external
+        Column** cols_;
+        size_t ncols_;
+        // Per chunk: its total after the first pass, its offset going into
+        // the second
+        double* totals_;
+        // The running sums, already sized to the number of rows, external
+        FloatArray* out_;
+        bool second_pass_;
+        // The rows of a view, external, nullptr for every row
+        SizeArray* rows_;
+
+        PrefixSumTask(Column** cols, size_t ncols, double* totals, FloatArray* out,
+                      bool second_pass, SizeArray* rows, size_t nchunks, size_t nworkers)
+            : ChunkTask(nchunks, nworkers) {
+            cols_ = cols;
+            ncols_ = ncols;
+            totals_ = totals;
+            out_ = out;
+            second_pass_ = second_pass;
+            rows_ = rows;
+        }
+
+        /** Adds the values of chunk k of the given column to sums, one per row. */
+        void add_chunk_(Column* col, size_t k, double* sums, size_t len) {
+            size_t start = k * ARRAY_CHUNK_SIZE;
+            if (rows_ != nullptr && col->get_type() == 'I') {
+                IntColumn* ints = col->as_int();
+                for (size_t i = 0; i < len; i++) sums[i] += ints->get(rows_->get(start + i));
+            } else if (rows_ != nullptr) {
+                FloatColumn* floats = col->as_float();
+                for (size_t i = 0; i < len; i++) sums[i] += floats->get(rows_->get(start + i));
+            } else if (col->get_type() == 'I') {
+                const int* vals = col->as_int()->get_fields()->chunk(k);
+                for (size_t i = 0; i < len; i++) sums[i] += vals[i];
+            } else {
+                const float* vals = col->as_float()->get_fields()->chunk(k);
+                for (size_t i = 0; i < len; i++) sums[i] += vals[i];
+            }
+        }
+
+        void run_chunk(size_t k) {
+            size_t len = out_->chunk_length(k);
+            double* sums = new double[len];
+            for (size_t i = 0; i < len; i++) sums[i] = 0;
+            for (size_t c = 0; c < ncols_; c++) {
+                add_chunk_(cols_[c], k, sums, len);
+            }
+            double running = second_pass_ ? totals_[k] : 0;
+            float* dst = out_->chunk(k);
+            for (size_t i = 0; i < len; i++) {
+                running += sums[i];
+                if (second_pass_) dst[i] = running;
+            }
+            // After the second pass, the offset of the next chunk
+            totals_[k] = running;
+            delete[] sums;
+        }
+};
+
+/**
+ * Task that runs a filter's predicate in parallel, one storage chunk of rows
+ * per unit of work. Each chunk is checked by its own Rower, and whether each
+ * row passed is recorded in a shared selection bitmap. Chunks cover whole
+ * words of the bitmap, so no two workers write the same word. For a view, row
+ * i of the bitmap is row i of the view.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class SelectTask : public ChunkTask {
+    public:
+        // The dataframe's columns and schema, external
+        Array* columns_;
+        Schema* schema_;
+        size_t length_;
+        // One Rower per chunk, external
+        Rower** rowers_;
+        // The selection bitmap, already sized to the number of rows, external
+        BoolArray* sel_;
+        // Number of selected rows in each chunk, external
+        size_t* counts_;
+        // The rows of a view, external, nullptr for every row
+        SizeArray* rows_;
+
+        SelectTask(Array* columns, Schema* schema, size_t length, SizeArray* rows,
+                   Rower** rowers, BoolArray* sel, size_t* counts, size_t nchunks,
+                   size_t nworkers)
+            : ChunkTask(nchunks, nworkers) {
+            columns_ = columns;
+            schema_ = schema;
+            length_ = length;
+            rows_ = rows;
+            rowers_ = rowers;
+            sel_ = sel;
+            counts_ = counts;
+        }
+
+        void run_chunk(size_t k) {
+            size_t start = k * ARRAY_CHUNK_SIZE;
+            size_t end = start + ARRAY_CHUNK_SIZE < length_ ? start + ARRAY_CHUNK_SIZE : length_;
+            RowView view(columns_, schema_);
+            Rower* r = rowers_[k];
+            size_t count = 0;
+            for (size_t w = start; w < end; w += 64) {
+                size_t word_end = w + 64 < end ? w + 64 : end;
+                uint64_t word = 0;
+                for (size_t i = w; i < word_end; i++) {
+                    view.set_idx(i, rows_ == nullptr ? i : rows_->get(i));
+                    if (r->accept(view)) word |= (uint64_t)1 << (i - w);
+                }
+                sel_->set_word(w / 64, word);
+                count += __builtin_popcountll(word);
+            }
+            counts_[k] = count;
+        }
+};
+
+/**
+ * Task that copies some rows of some columns into new columns, in order. An
+ * int or float column is split into one unit of work per chunk of rows, each
+ * writing its rows straight to their final position. Bool and string columns
+ * are appended to, so each of them is a single unit. So is the bitmap of
+ * missing values of an int or float column that has or may get some, which
+ * is built by appending too. Subclasses decide which rows are copied.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class CopyRowsTask : public ChunkTask {
+    public:
+        // The columns to copy from and to, external. Int and float
+        // destinations are already sized to the number of copied rows.
+        Column** src_;
+        Column** dst_;
+        // Column and chunk of each unit, SIZE_MAX for a whole column
+        size_t* unit_cols_;
+        size_t* unit_chunks_;
+
+        /** Copies rows of the ncols columns of src to those of dst, nchunks
+         *  chunks of rows. missing tells whether some of the copied rows may
+         *  be missing from src altogether (see TakeTask). */
+        CopyRowsTask(Column** src, Column** dst, size_t ncols, size_t nchunks, bool missing,
+                     size_t nworkers)
+            : ChunkTask(count_units_(src, ncols, nchunks, missing), nworkers) {
+            src_ = src;
+            dst_ = dst;
+            unit_cols_ = new size_t[nchunks_];
+            unit_chunks_ = new size_t[nchunks_];
+            size_t u = 0;
+            for (size_t c = 0; c < ncols; c++) {
+                if (is_numeric_(src[c])) {
+                    for (size_t k = 0; k < nchunks; k++) {
+                        unit_cols_[u] = c;
+                        unit_chunks_[u++] = k;
+                    }
+                    if (missing || src[c]->get_validity() != nullptr) {
+                        unit_cols_[u] = c;
+                        unit_chunks_[u++] = SIZE_MAX;
+                    }
+                } else {
+                    unit_cols_[u] = c;
+                    unit_chunks_[u++] = SIZE_MAX;
+                }
+            }
+        }
+
+        ~CopyRowsTask() {
+            delete[] unit_cols_;
+            delete[] unit_chunks_;
+        }
+
+        static bool is_numeric_(Column* col) {
+            return col->get_type() == 'I' || col->get_type() == 'F';
+        }
+
+        static size_t count_units_(Column** src, size_t ncols, size_t nchunks, bool missing) {
+            size_t units = 0;
+            for (size_t c = 0; c < ncols; c++) {
+                if (is_numeric_(src[c])) {
+                    units += nchunks;
+                    if (missing || src[c]->get_validity() != nullptr) units++;
+                } else {
+                    units++;
+                }
+            }
+            return units;
+        }
+
+        /** Appends row i of src, a bool or string column, to dst. */
+        static void append_row_(Column* src, Column* dst, size_t i) {
+            if (src->get_type() == 'B') {
+                if (src->is_missing(i)) {
+                    dst->append_missing();
+                } else {
+                    dst->push_back(src->as_bool()->get(i));
+                }
+                return;
+            }
+            StringColumn* from = src->as_string();
+            int size = from->get_size(i);
+            if (size < 0) {
+                dst->append_missing();
+            } else {
+                dst->as_string()->push_back_chars(from->get_chars(i), size);
+            }
+        }
+
+        /** Subclass responsibility, copies the rows of chunk k of src, an int
+         *  or float column, to dst. */
+        virtual void copy_chunk_(Column* src, Column* dst, size_t k) = 0;
+
+        /** Subclass responsibility, appends every copied row of src, a bool or
+         *  string column, to dst. */
+        virtual void copy_column_(Column* src, Column* dst) = 0;
+
+        /** Subclass responsibility, appends whether each copied row of src,
+         *  an int or float column, is present to valid. */
+        virtual void copy_validity_(Column* src, BoolArray* valid) = 0;
+
+        void run_chunk(size_t u) {
+            Column* src = src_[unit_cols_[u]];
+            Column* dst = dst_[unit_cols_[u]];
+            if (unit_chunks_[u] == SIZE_MAX && is_numeric_(src)) {
+                BoolArray* valid = new BoolArray();
+                copy_validity_(src, valid);
+                // Keep the all present case free of a bitmap
+                if (valid->count_true() == valid->size()) {
+                    delete valid;
+                    valid = nullptr;
+                }
+                dst->valid_ = valid;
+            } else if (unit_chunks_[u] == SIZE_MAX) {
+                copy_column_(src, dst);
+            } else {
+                copy_chunk_(src, dst, unit_chunks_[u]);
+            }
+        }
+};
+
+/**
+ * Copies the rows selected in a bitmap. Each chunk is a storage chunk of the
+ * source columns.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class GatherTask : public CopyRowsTask {
+    public:
+        // Which rows to copy, external
+        BoolArray* sel_;
+        // Number of selected rows before each storage chunk, external
+        size_t* starts_;
+
+        GatherTask(Column** src, Column** dst, size_t ncols, BoolArray* sel, size_t* starts,
+                   size_t nchunks, size_t nworkers)
+            : CopyRowsTask(src, dst, ncols, nchunks, false, nworkers) {
+            sel_ = sel;
+            starts_ = starts;
+        }
+
+        /** Copies the selected rows of storage chunk k of src to dst. */
+        template <class A>
+        void gather_chunk_(A* src, A* dst, size_t k) {
+            auto vals = src->chunk(k);
+            size_t pos = starts_[k];
+            size_t start = k * ARRAY_CHUNK_SIZE;
+            size_t words = (src->chunk_length(k) + 63) / 64;
+            for (size_t w = 0; w < words; w++) {
+                uint64_t word = sel_->get_word(start / 64 + w);
+                while (word != 0) {
+                    size_t i = w * 64 + __builtin_ctzll(word);
+                    dst->chunk(pos >> ARRAY_CHUNK_SHIFT)[pos & ARRAY_CHUNK_MASK] = vals[i];
+                    pos++;
+                    word &= word - 1;
+                }
+            }
+        }
+
+        void copy_chunk_(Column* src, Column* dst, size_t k) {
+            if (src->get_type() == 'I') {
+                gather_chunk_(src->as_int()->get_fields(), dst->as_int()->get_fields(), k);
+            } else {
+                gather_chunk_(src->as_float()->get_fields(), dst->as_float()->get_fields(), k);
+            }
+        }
+
+        void copy_column_(Column* src, Column* dst) {
+            SetBitIterator it(sel_);
+            while (it.has_next()) {
+                append_row_(src, dst, it.next());
+            }
+        }
+
+        void copy_validity_(Column* src, BoolArray* valid) {
+            BoolArray* from = src->get_validity();
+            SetBitIterator it(sel_);
+            while (it.has_next()) {
+                valid->append(from->get(it.next()));
+            }
+        }
+};
+
+/**
+ * Copies the rows listed in a selection vector, in the order listed. A listed
+ * row of SIZE_MAX stands for a missing value. Each chunk is a storage chunk of
+ * the destination columns.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class TakeTask : public CopyRowsTask {
+    public:
+        // The rows to copy, external, or nullptr to copy rows 0 to length_
+        SizeArray* rows_;
+        size_t length_;
+
+        /** missing tells whether rows may list SIZE_MAX. */
+        TakeTask(Column** src, Column** dst, size_t ncols, SizeArray* rows, size_t length,
+                 bool missing, size_t nworkers)
+            : CopyRowsTask(src, dst, ncols, (length + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE,
+                           missing, nworkers) {
+            rows_ = rows;
+            length_ = length;
+        }
+
+        size_t row_(size_t i) {
+            return rows_ == nullptr ? i : rows_->get(i);
+        }
+
+        /** Fills storage chunk k of dst. */
+        template <class A>
+        void take_chunk_(A* src, A* dst, size_t k) {
+            auto out = dst->chunk(k);
+            size_t start = k * ARRAY_CHUNK_SIZE;
+            size_t len = dst->chunk_length(k);
+            for (size_t i = 0; i < len; i++) {
+                size_t row = row_(start + i);
+                out[i] = row == SIZE_MAX ? 0 : src->get(row);
+            }
+        }
+
+        void copy_chunk_(Column* src, Column* dst, size_t k) {
+            if (src->get_type() == 'I') {
+                take_chunk_(src->as_int()->get_fields(), dst->as_int()->get_fields(), k);
+            } else {
+                take_chunk_(src->as_float()->get_fields(), dst->as_float()->get_fields(), k);
+            }
+        }
+
+        void copy_column_(Column* src, Column* dst) {
+            for (size_t i = 0; i < length_; i++) {
+                size_t row = row_(i);
+                if (row == SIZE_MAX) {
+                    dst->append_missing();
+                } else {
+                    append_row_(src, dst, row);
+                }
+            }
+        }
+
+        void copy_validity_(Column* src, BoolArray* valid) {
+            valid->reserve(length_);
+            for (size_t i = 0; i < length_; i++) {
+                size_t row = row_(i);
+                valid->append(row != SIZE_MAX && !src->is_missing(row));
+            }
+        }
+};
  
 /****************************************************************************
  * DataFrame::
@@ -57,6 +558,10 @@ class PrintRower : public Rower {
  * A DataFrame is table composed of columns of equal length. Each column
  * holds values of the same type (I, S, B, F). A dataframe has a schema that
  * describes it.
+ *
+ * A dataframe can also be a view (see filter_view): it reads the columns of
+ * another frame through a selection vector listing the rows it contains,
+ * and copies nothing until it is materialized.
  * 
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
@@ -67,12 +572,27 @@ class DataFrame : public Object {
         Schema* schema_;
         // Number of rows
         size_t length_;
-        
-        // Used for pmap():
-        // The original Rower passed to pmap() that runs on the first quarter of the df.
-        Rower* r_;
-        // The clone Rowers that run on the other quarters of the df.
-        Rower* r2_;
+        // Number of threads pmap() uses by default, 0 means one per hardware thread
+        size_t nthreads_;
+        // Worker threads used by pmap(), created on first use and kept until destruction
+        ThreadPool* pool_;
+        // Index that map() and pmap() report for the first row (see set_row_base)
+        size_t row_base_;
+        // Owners of memory that columns point into (e.g. a MappedFile), freed with the frame
+        Array* backing_;
+        // For a view, the row of the columns that each of its rows reads;
+        // nullptr for a frame that holds its own rows
+        SizeArray* rows_;
+        // Typed directory of the columns, extended whenever one is added: the
+        // type of each column, and the column under its own type with nullptr
+        // under the other three, so that the typed accessors make no virtual
+        // calls
+        char* dir_types_;
+        IntColumn** int_cols_;
+        BoolColumn** bool_cols_;
+        FloatColumn** float_cols_;
+        StringColumn** string_cols_;
+        size_t dir_capacity_;
  
         /** Create a data frame with the same columns as the given df but with no rows or rownames */
         DataFrame(DataFrame& df) {
@@ -81,6 +601,32 @@ class DataFrame : public Object {
             schema_ = new Schema(df.get_schema());
             schema_->clear_row_names();
             length_ = df.nrows();
+            nthreads_ = 0;
+            pool_ = nullptr;
+            row_base_ = 0;
+            backing_ = new Array();
+            rows_ = nullptr;
+            init_directory_();
+        }
+
+        /** Create a view of the rows of df listed in rows, which the view
+          * acquires. The view reads df's columns, which must outlive it.
+          * Rows are given as rows of df's columns, so a view of a view reads
+          * straight from the frame that holds the rows. */
+        DataFrame(DataFrame& df, SizeArray* rows) {
+            columns_ = new Array();
+            schema_ = new Schema();
+            for (size_t i = 0; i < df.ncols(); i++) {
+                columns_->append(df.columns_->get(i));
+                schema_->add_column(df.schema_->col_type(i), df.schema_->col_name(i));
+            }
+            length_ = rows->size();
+            nthreads_ = df.nthreads_;
+            pool_ = nullptr;
+            row_base_ = 0;
+            backing_ = new Array();
+            rows_ = rows;
+            init_directory_();
         }
         
         /** Create a data frame from a schema and columns. All columns are created
@@ -107,12 +653,124 @@ class DataFrame : public Object {
             }
             schema_ = new Schema(schema);
             length_ = 0;
+            nthreads_ = 0;
+            pool_ = nullptr;
+            row_base_ = 0;
+            backing_ = new Array();
+            rows_ = nullptr;
+            init_directory_();
         }
 
         /** Destructor */
         ~DataFrame() {
             delete columns_;
             delete schema_;
+            delete pool_;
+            for (size_t i = 0; i < backing_->size(); i++) {
+                delete backing_->get(i);
+            }
+            delete backing_;
+            delete rows_;
+            free_directory_();
+        }
+
+        /** Private function that builds the typed directory of the current
+         *  columns. */
+        void init_directory_() {
+            dir_capacity_ = columns_->size() < 8 ? 8 : columns_->size();
+            dir_types_ = new char[dir_capacity_];
+            int_cols_ = new IntColumn*[dir_capacity_];
+            bool_cols_ = new BoolColumn*[dir_capacity_];
+            float_cols_ = new FloatColumn*[dir_capacity_];
+            string_cols_ = new StringColumn*[dir_capacity_];
+            for (size_t i = 0; i < columns_->size(); i++) {
+                index_column_(i);
+            }
+        }
+
+        /** Private function that frees the typed directory. */
+        void free_directory_() {
+            delete[] dir_types_;
+            delete[] int_cols_;
+            delete[] bool_cols_;
+            delete[] float_cols_;
+            delete[] string_cols_;
+        }
+
+        /** Private function that adds column i, which must be the last column
+         *  added, to the typed directory. */
+        void index_column_(size_t i) {
+            if (i == dir_capacity_) {
+                char* types = dir_types_;
+                IntColumn** ints = int_cols_;
+                BoolColumn** bools = bool_cols_;
+                FloatColumn** floats = float_cols_;
+                StringColumn** strings = string_cols_;
+                dir_capacity_ *= 2;
+                dir_types_ = new char[dir_capacity_];
+                int_cols_ = new IntColumn*[dir_capacity_];
+                bool_cols_ = new BoolColumn*[dir_capacity_];
+                float_cols_ = new FloatColumn*[dir_capacity_];
+                string_cols_ = new StringColumn*[dir_capacity_];
+                memcpy(dir_types_, types, i * sizeof(char));
+                memcpy(int_cols_, ints, i * sizeof(IntColumn*));
+                memcpy(bool_cols_, bools, i * sizeof(BoolColumn*));
+                memcpy(float_cols_, floats, i * sizeof(FloatColumn*));
+                memcpy(string_cols_, strings, i * sizeof(StringColumn*));
+                delete[] types;
+                delete[] ints;
+                delete[] bools;
+                delete[] floats;
+                delete[] strings;
+            }
+            Column* col = static_cast<Column*>(columns_->get(i));
+            dir_types_[i] = col->get_type();
+            int_cols_[i] = dir_types_[i] == 'I' ? static_cast<IntColumn*>(col) : nullptr;
+            bool_cols_[i] = dir_types_[i] == 'B' ? static_cast<BoolColumn*>(col) : nullptr;
+            float_cols_[i] = dir_types_[i] == 'F' ? static_cast<FloatColumn*>(col) : nullptr;
+            string_cols_[i] = dir_types_[i] == 'S' ? static_cast<StringColumn*>(col) : nullptr;
+        }
+
+        /** Typed column lookups through the directory: return the column at
+         *  the given index, loaded if it is loaded lazily. Terminate if it is
+         *  out of bounds or of another type. */
+        IntColumn* int_column_(size_t col) {
+            exit_if_not(col < columns_->size(), "Column index out of bounds.");
+            IntColumn* column = int_cols_[col];
+            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
+            column->materialize();
+            return column;
+        }
+        BoolColumn* bool_column_(size_t col) {
+            exit_if_not(col < columns_->size(), "Column index out of bounds.");
+            BoolColumn* column = bool_cols_[col];
+            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
+            column->materialize();
+            return column;
+        }
+        FloatColumn* float_column_(size_t col) {
+            exit_if_not(col < columns_->size(), "Column index out of bounds.");
+            FloatColumn* column = float_cols_[col];
+            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
+            column->materialize();
+            return column;
+        }
+        StringColumn* string_column_(size_t col) {
+            exit_if_not(col < columns_->size(), "Column index out of bounds.");
+            StringColumn* column = string_cols_[col];
+            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
+            column->materialize();
+            return column;
+        }
+
+        /** Whether this frame is a view of another frame's rows. */
+        bool is_view() {
+            return rows_ != nullptr;
+        }
+
+        /** Returns the row of the columns that holds the given row. */
+        size_t row_(size_t row) {
+            return rows_ == nullptr ? row : rows_->get(row);
         }
         
         /** Returns the dataframe's schema. Modifying the schema after a dataframe
@@ -126,15 +784,17 @@ class DataFrame : public Object {
           * name is optional and external. A nullptr column is undefined. */
         void add_column(Column* col, String* name) {
             exit_if_not(col != nullptr, "Undefined column provided.");
-            if (col->size() < length_) {
+            exit_if_not(rows_ == nullptr, "Cannot add a column to a view.");
+            if (col->length() < length_) {
                 pad_column(col);
-            } else if (col->size() > length_) {
-                length_ = col->size();
+            } else if (col->length() > length_) {
+                length_ = col->length();
                 for (int i = 0; i < columns_->size(); i++) {
-                    pad_column(dynamic_cast<Column*>(columns_->get(i)));
+                    pad_column(static_cast<Column*>(columns_->get(i)));
                 }
             }
             columns_->append(col);
+            index_column_(columns_->size() - 1);
             if (columns_->size() > schema_->width()) {
                 schema_->add_column(col->get_type(), name);
             }
@@ -143,26 +803,30 @@ class DataFrame : public Object {
         /** Return the value at the given column and row. Accessing rows or
          *  columns out of bounds, or request the wrong type is undefined.*/
         int get_int(size_t col, size_t row) {
-            IntColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_int();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            return column->get(row);
+            IntColumn* column = int_column_(col);
+            return column->get(row_(row));
         }
         bool get_bool(size_t col, size_t row) {
-            BoolColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_bool();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            return column->get(row);
+            BoolColumn* column = bool_column_(col);
+            return column->get(row_(row));
         }
         float get_float(size_t col, size_t row) {
-            FloatColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_float();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            return column->get(row);
+            FloatColumn* column = float_column_(col);
+            return column->get(row_(row));
         }
+        /** The String is a copy that belongs to the caller. */
         String* get_string(size_t col, size_t row) {
-            StringColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_string();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            return column->get(row);
+            StringColumn* column = string_column_(col);
+            return column->get(row_(row));
         }
-        
+
+        /** Returns whether the value at the given column and row is missing.
+         *  The getters return 0, false, 0.0 or nullptr for it. */
+        bool is_missing(size_t col, size_t row) {
+            exit_if_not(col < ncols() && row < length_, "Index out of bounds.");
+            return column_(col)->is_missing(row_(row));
+        }
+
         /** Return the offset of the given column name or -1 if no such col. */
         int get_col(String& col) {
             return schema_->col_idx(col.c_str());
@@ -175,48 +839,45 @@ class DataFrame : public Object {
         
         /** Set the value at the given column and row to the given value.
           * If the column is not  of the right type or the indices are out of
-          * bound, the result is undefined. */
+          * bound, the result is undefined. Setting a value of a view sets it
+          * in the frame the view reads from. */
         void set(size_t col, size_t row, int val) {
-            IntColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_int();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            column->set(row, val);
+            IntColumn* column = int_column_(col);
+            column->set(row_(row), val);
         }
         void set(size_t col, size_t row, bool val) {
-            BoolColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_bool();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            column->set(row, val);
+            BoolColumn* column = bool_column_(col);
+            column->set(row_(row), val);
         }
         void set(size_t col, size_t row, float val) {
-            FloatColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_float();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            column->set(row, val);
+            FloatColumn* column = float_column_(col);
+            column->set(row_(row), val);
         }
         void set(size_t col, size_t row, String* val) {
-            StringColumn* column = dynamic_cast<Column*>(columns_->get(col))->as_string();
-            exit_if_not(column != nullptr, "Column index corresponds to the wrong type.");
-            column->set(row, val);
+            StringColumn* column = string_column_(col);
+            column->set(row_(row), val);
         }
         
         /** Set the fields of the given row object with values from the columns at
           * the given offset.  If the row is not form the same schema as the
-          * dataframe, results are undefined. */
-        void fill_row(size_t idx, Row& row) {
+          * dataframe, results are undefined. Strings are not copied, they are
+          * only valid until the frame changes. */
+        void fill_row(size_t row_idx, Row& row) {
             exit_if_not(schema_->get_types()->equals(row.get_types()), "Row's schema does not match the data frame's.");
+            size_t idx = row_(row_idx);
             for (int j = 0; j < ncols(); j++) {
-                Column* col = dynamic_cast<Column*>(columns_->get(j));
-                char type = col->get_type();
-                switch (type) {
+                switch (dir_types_[j]) {
                     case 'I':
-                        row.set(j, col->as_int()->get(idx));
+                        row.set(j, int_column_(j)->get(idx));
                         break;
                     case 'B':
-                        row.set(j, col->as_bool()->get(idx));
+                        row.set(j, bool_column_(j)->get(idx));
                         break;
                     case 'F':
-                        row.set(j, col->as_float()->get(idx));
+                        row.set(j, float_column_(j)->get(idx));
                         break;
                     case 'S':
-                        row.set(j, col->as_string()->get(idx));
+                        row.set_view(j, string_column_(j), idx);
                         break;
                     default:
                         exit_if_not(false, "Column has invalid type.");
@@ -228,21 +889,20 @@ class DataFrame : public Object {
           * the right schema and be filled with values, otherwise undefined.  */
         void add_row(Row& row) {
             exit_if_not(schema_->get_types()->equals(row.get_types()), "Row's schema does not match the data frame's.");
+            exit_if_not(rows_ == nullptr, "Cannot add a row to a view.");
             for (int j = 0; j < ncols(); j++) {
-                Column* col = dynamic_cast<Column*>(columns_->get(j));
-                char type = col->get_type();
-                switch (type) {
+                switch (dir_types_[j]) {
                     case 'I':
-                        col->push_back(row.get_int(j));
+                        int_column_(j)->push_back(row.get_int(j));
                         break;
                     case 'B':
-                        col->push_back(row.get_bool(j));
+                        bool_column_(j)->push_back(row.get_bool(j));
                         break;
                     case 'F':
-                        col->push_back(row.get_float(j));
+                        float_column_(j)->push_back(row.get_float(j));
                         break;
                     case 'S':
-                        col->push_back(row.get_string(j));
+                        string_column_(j)->push_back(row.get_string(j));
                         break;
                     default:
                         exit_if_not(false, "Column has invalid type.");
@@ -250,6 +910,59 @@ class DataFrame : public Object {
             }
             length_++;
         }
+
+        /** Add the rows held by cols, one column per column of the schema
+         *  with the same type and all of the same length. The schema is
+         *  checked once for the whole batch and every column is copied in
+         *  bulk. The columns are external. */
+        void append_columns(Column** cols) {
+            exit_if_not(rows_ == nullptr, "Cannot add a row to a view.");
+            exit_if_not(cols != nullptr, "Undefined columns provided.");
+            size_t n = 0;
+            for (size_t j = 0; j < ncols(); j++) {
+                exit_if_not(cols[j] != nullptr && cols[j]->get_type() == dir_types_[j],
+                            "Columns do not match the data frame's schema.");
+                if (j == 0) n = cols[j]->length();
+                exit_if_not(cols[j]->length() == n, "Columns must all have the same length.");
+            }
+            for (size_t j = 0; j < ncols(); j++) {
+                column_(j)->append_all(cols[j]);
+            }
+            length_ += n;
+        }
+
+        /** Add n rows held in typed buffers, one per column of the schema: an
+         *  int*, bool*, float* or String** (where nullptr is a missing
+         *  field) according to the type of the column. Ints and floats are
+         *  copied a chunk at a time and bools a word at a time. The buffers
+         *  are external. */
+        void append_buffers(size_t n, void** buffers) {
+            exit_if_not(rows_ == nullptr, "Cannot add a row to a view.");
+            exit_if_not(buffers != nullptr, "Undefined buffers provided.");
+            for (size_t j = 0; j < ncols(); j++) {
+                exit_if_not(n == 0 || buffers[j] != nullptr, "Undefined buffer provided.");
+            }
+            if (n == 0) return;
+            for (size_t j = 0; j < ncols(); j++) {
+                switch (dir_types_[j]) {
+                    case 'I':
+                        int_column_(j)->append_all(static_cast<const int*>(buffers[j]), n);
+                        break;
+                    case 'B':
+                        bool_column_(j)->append_all(static_cast<const bool*>(buffers[j]), n);
+                        break;
+                    case 'F':
+                        float_column_(j)->append_all(static_cast<const float*>(buffers[j]), n);
+                        break;
+                    case 'S':
+                        string_column_(j)->append_all(static_cast<String**>(buffers[j]), n);
+                        break;
+                    default:
+                        exit_if_not(false, "Column has invalid type.");
+                }
+            }
+            length_ += n;
+        }
         
         /** The number of rows in the dataframe. */
         size_t nrows() {
@@ -261,50 +974,620 @@ class DataFrame : public Object {
             return columns_->size();
         }
         
-        /** Visit rows in order */
+        /** Visit rows in order. Rows report their index in this frame, which
+          * for a view is their position in the view, not in its parent. */
         void map(Rower& r) {
-            Row* row = new Row(*schema_);
-            for (int i = 0; i < length_; i++) {
-                row->set_idx(i);
-                fill_row(i, *row);
-                r.accept(*row);
-            }
-            delete row;
+            map_x(&r, 0, length_);
         }
 
-        void map_x(int x) {
-            int start, end;
-            Rower* r;
-            Row* row = new Row(*schema_);
-            if (x == 1) {
-                r = r_;
-                start = 0;
-                end = length_ / 2;
-            } else {
-                r = r2_;
-                start = length_ / 2;
-                end = length_;
+        /** Visit rows [start, end) in order with the given Rower, in blocks
+          * of at most BLOCK_ROWS rows aligned to multiples of BLOCK_ROWS. The
+          * rows of a view are not contiguous, so it hands them out one at a
+          * time through a RowView instead. */
+        void map_x(Rower* r, size_t start, size_t end) {
+            if (rows_ != nullptr) {
+                RowView view(columns_, schema_);
+                view.set_base(row_base_);
+                for (size_t i = start; i < end; i++) {
+                    view.set_idx(i, rows_->get(i));
+                    r->accept(view);
+                }
+                return;
             }
-            for (int i = start; i < end; i++) {
-                row->set_idx(i);
-                fill_row(i, *row);
-                r->accept(*row);
+            RowBlock block(columns_, schema_);
+            block.set_base(row_base_);
+            while (start < end) {
+                size_t block_end = (start / BLOCK_ROWS + 1) * BLOCK_ROWS;
+                if (block_end > end) block_end = end;
+                block.set_range(start, block_end);
+                r->accept(block);
+                start = block_end;
             }
-            delete row;
+        }
+
+        /** Hands the frame an object that owns memory its columns point into,
+          * such as the MappedFile of a binary frame. It is deleted along with
+          * the frame. */
+        void add_backing(Object* owner) {
+            backing_->append(owner);
+        }
+
+        /** Sets the number of threads pmap() uses when none is given. 0 means
+          * one thread per hardware thread. */
+        void set_num_threads(size_t nthreads) {
+            nthreads_ = nthreads;
+        }
+
+        /** Sets the index that map() and pmap() report for the first row of
+          * this frame, when it is one piece of a larger whole such as a
+          * chunk of a stream (see SorParser::parseChunk). Rows are still read
+          * from 0 on, only the indices Rowers see change. */
+        void set_row_base(size_t base) {
+            row_base_ = base;
+        }
+
+        /** Hands this frame a pool for pmap() to use, which the frame then
+          * owns. Lets a pool outlive the frames that run on it (see
+          * release_pool). */
+        void adopt_pool(ThreadPool* pool) {
+            delete pool_;
+            pool_ = pool;
+        }
+
+        /** Gives up the frame's pool, nullptr if it has none yet. The caller
+          * owns it. */
+        ThreadPool* release_pool() {
+            ThreadPool* pool = pool_;
+            pool_ = nullptr;
+            return pool;
+        }
+
+        /** Returns a pool with at least nthreads workers to run a ChunkTask
+          * of nthreads workers on, reusing the current one if it is large
+          * enough (see ChunkTask::run_task). */
+        ThreadPool* get_pool(size_t nthreads) {
+            if (pool_ != nullptr && pool_->size() < nthreads) {
+                delete pool_;
+                pool_ = nullptr;
+            }
+            if (pool_ == nullptr) pool_ = new ThreadPool(nthreads);
+            return pool_;
         }
 
         /** This method clones the Rower and executes the map in parallel. Join is
           * used at the end to merge the results. */
         void pmap(Rower& r) {
-            r_ = &r;
-            r2_ = dynamic_cast<Rower*>(r_->clone());
-            std::thread t1(&DataFrame::map_x, this, 1);
-            std::thread t2(&DataFrame::map_x, this, 2);
-            t1.join();
-            t2.join();
-            r_->join_delete(r2_);
+            pmap(r, nthreads_);
+        }
+
+        /** Same as pmap(r), but runs on nthreads workers (0 means one per
+          * hardware thread). The rows are split into chunks of PMAP_CHUNK_ROWS
+          * that idle workers steal from busy ones, so uneven per-row costs do not
+          * leave threads waiting. Each chunk gets its own clone of r, and the
+          * clones are joined into r in chunk order. */
+        void pmap(Rower& r, size_t nthreads) {
+            size_t n = nthreads == 0 ? ThreadPool::default_size() : nthreads;
+            // Shrink the chunks of small frames so that every worker gets one
+            size_t chunk_rows = PMAP_CHUNK_ROWS;
+            if (length_ < n * chunk_rows) {
+                // Keep chunks made of whole blocks
+                chunk_rows = (length_ + n - 1) / n;
+                chunk_rows = (chunk_rows + BLOCK_ROWS - 1) / BLOCK_ROWS * BLOCK_ROWS;
+            }
+            size_t nchunks = chunk_rows == 0 ? 0 : (length_ + chunk_rows - 1) / chunk_rows;
+            if (n > nchunks) n = nchunks;
+            if (n <= 1) {
+                map(r);
+                return;
+            }
+
+            Rower** rowers = new Rower*[nchunks];
+            rowers[0] = &r;
+            for (size_t i = 1; i < nchunks; i++) {
+                rowers[i] = dynamic_cast<Rower*>(r.clone());
+            }
+            PmapTask task(this, rowers, nchunks, chunk_rows, n);
+            get_pool(n)->run(&task);
+            for (size_t i = 1; i < nchunks; i++) {
+                r.join_delete(rowers[i]);
+            }
+            delete[] rowers;
         }
         
+        /** Summarizes the given int and float columns, splitting the work
+          * across the pmap() threads by column and by storage chunk. The i-th
+          * summary is written to out[i] and owned by the caller. */
+        void stats_(Column** cols, size_t ncols, ColumnStats** out) {
+            size_t chunks_per_col = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = nthreads_ == 0 ? ThreadPool::default_size() : nthreads_;
+            if (n > ncols * chunks_per_col) n = ncols * chunks_per_col;
+            if (n == 0) n = 1;
+            StatsTask task(cols, ncols, chunks_per_col, rows_, length_, n);
+            if (n == 1) {
+                task.run_task(0);
+            } else {
+                get_pool(n)->run(&task);
+            }
+            for (size_t i = 0; i < ncols; i++) {
+                out[i] = task.result(i);
+            }
+        }
+
+        /** Returns the count, sum, min, max, mean and variance of the given int
+          * or float column, computed in parallel. The caller must delete it. */
+        ColumnStats* stats(size_t col) {
+            Column* column = column_(col);
+            exit_if_not(column->get_type() == 'I' || column->get_type() == 'F',
+                        "Statistics need an int or float column.");
+            ColumnStats* res;
+            stats_(&column, 1, &res);
+            return res;
+        }
+
+        /** Summarizes every column at once, in parallel across columns and
+          * row chunks. Returns one ColumnStats per column, nullptr for bool and
+          * string columns. The caller must delete the array and its elements. */
+        Array* stats() {
+            Column** cols = new Column*[ncols()];
+            size_t* idx = new size_t[ncols()];
+            size_t n = 0;
+            for (size_t j = 0; j < ncols(); j++) {
+                char type = schema_->col_type(j);
+                if (type == 'I' || type == 'F') {
+                    idx[n] = j;
+                    cols[n++] = column_(j);
+                }
+            }
+            ColumnStats** out = new ColumnStats*[n];
+            stats_(cols, n, out);
+            Array* res = new Array();
+            for (size_t j = 0; j < ncols(); j++) {
+                res->append(nullptr);
+            }
+            for (size_t i = 0; i < n; i++) {
+                res->set(out[i], idx[i]);
+            }
+            delete[] cols;
+            delete[] idx;
+            delete[] out;
+            return res;
+        }
+
+        /** Returns a new column whose i-th field is the sum of every field of
+          * the given int and float columns in rows 0 to i, the running total
+          * being kept in a double. The column is external, ready to be handed
+          * to add_column. The rows are cut into storage chunks that are summed
+          * in parallel, then each chunk's running sums are written in parallel
+          * starting from the total of the chunks before it. */
+        FloatColumn* prefix_sum(size_t* cols, size_t ncols) {
+            Column** columns = new Column*[ncols];
+            for (size_t c = 0; c < ncols; c++) {
+                columns[c] = column_(cols[c]);
+                exit_if_not(columns[c]->get_type() == 'I' || columns[c]->get_type() == 'F',
+                            "Prefix sums need int or float columns.");
+            }
+            FloatColumn* res = new FloatColumn();
+            FloatArray* out = res->get_fields();
+            out->resize(length_);
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = nthreads_ == 0 ? ThreadPool::default_size() : nthreads_;
+            if (n > nchunks) n = nchunks;
+            double* totals = new double[nchunks];
+            if (n <= 1) {
+                // One sequential pass, each chunk starting where the last ended
+                PrefixSumTask task(columns, ncols, totals, out, true, rows_, nchunks, 1);
+                double offset = 0;
+                for (size_t k = 0; k < nchunks; k++) {
+                    totals[k] = offset;
+                    task.run_chunk(k);
+                    offset = totals[k];
+                }
+            } else {
+                PrefixSumTask totals_task(columns, ncols, totals, out, false, rows_, nchunks, n);
+                get_pool(n)->run(&totals_task);
+                // Turn the chunk totals into the sum of the chunks before each
+                double offset = 0;
+                for (size_t k = 0; k < nchunks; k++) {
+                    double total = totals[k];
+                    totals[k] = offset;
+                    offset += total;
+                }
+                PrefixSumTask sums_task(columns, ncols, totals, out, true, rows_, nchunks, n);
+                get_pool(n)->run(&sums_task);
+            }
+            delete[] totals;
+            delete[] columns;
+            return res;
+        }
+
+        /** Returns the running sum of the given int or float column (see
+          * prefix_sum above). */
+        FloatColumn* prefix_sum(size_t col) {
+            return prefix_sum(&col, 1);
+        }
+
+        /** Groups the rows by the value of the int or string column key_col
+          * and returns a new dataframe with one row per group, in the order
+          * in which the groups first appear. Its first column holds the keys,
+          * a missing key being a group of its own, and it has one more column
+          * per aggregate: aggs[i] of column cols[i], one of AGG_COUNT (int),
+          * AGG_SUM and AGG_MEAN (float), and AGG_MIN and AGG_MAX (of the
+          * column's type), all but AGG_COUNT needing an int or float column.
+          * AGG_COUNT counts the rows of the group; the others leave out
+          * missing values, and are missing for a group that has none. The
+          * rows are grouped on the pmap() threads, one chunk of
+          * rows at a time, into one open addressing table per thread; the
+          * tables are merged at the end. A view is grouped in place, through
+          * its selection of rows. The arguments are external. */
+        DataFrame* group_by(size_t key_col, size_t* cols, const char* aggs, size_t naggs) {
+            Column* key = column_(key_col);
+            exit_if_not(key->get_type() == 'I' || key->get_type() == 'S',
+                        "Can only group by an int or string column.");
+            Column** vals = new Column*[naggs];
+            for (size_t i = 0; i < naggs; i++) {
+                char agg = aggs[i];
+                exit_if_not(agg == AGG_COUNT || agg == AGG_SUM || agg == AGG_MIN ||
+                            agg == AGG_MAX || agg == AGG_MEAN, "Invalid aggregate.");
+                vals[i] = agg == AGG_COUNT ? nullptr : column_(cols[i]);
+                exit_if_not(vals[i] == nullptr || vals[i]->get_type() == 'I' ||
+                            vals[i]->get_type() == 'F', "Can only aggregate an int or float column.");
+            }
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = threads_for_(nchunks);
+            GroupByTask task(key, vals, naggs, length_, rows_, nchunks, n);
+            run_task_(&task, n);
+            GroupTable* groups = task.result();
+
+            // List the groups in the order of their first rows
+            size_t ngroups = groups->size();
+            size_t* order = new size_t[ngroups];
+            for (size_t g = 0; g < ngroups; g++) {
+                order[g] = g;
+            }
+            size_t* firsts = groups->firsts_;
+            std::sort(order, order + ngroups, [firsts](size_t a, size_t b) {
+                return firsts[a] < firsts[b];
+            });
+
+            Schema schema;
+            DataFrame* df = new DataFrame(schema);
+            if (key->get_type() == 'I') {
+                IntColumn* keys = new IntColumn();
+                for (size_t g = 0; g < ngroups; g++) {
+                    if (order[g] == groups->missing_) {
+                        keys->append_missing();
+                    } else {
+                        keys->push_back(groups->int_keys_[order[g]]);
+                    }
+                }
+                df->add_column(keys, nullptr);
+            } else {
+                StringColumn* keys = new StringColumn();
+                for (size_t g = 0; g < ngroups; g++) {
+                    size_t h = order[g];
+                    if (groups->key_chars_[h] == nullptr) {
+                        keys->append_missing();
+                    } else {
+                        keys->push_back_chars(groups->key_chars_[h], groups->key_lens_[h]);
+                    }
+                }
+                df->add_column(keys, nullptr);
+            }
+            for (size_t i = 0; i < naggs; i++) {
+                char agg = aggs[i];
+                if (agg == AGG_COUNT) {
+                    IntColumn* col = new IntColumn();
+                    for (size_t g = 0; g < ngroups; g++) {
+                        col->push_back((int)groups->counts_[order[g]]);
+                    }
+                    df->add_column(col, nullptr);
+                } else if (vals[i]->get_type() == 'I' && (agg == AGG_MIN || agg == AGG_MAX)) {
+                    IntColumn* col = new IntColumn();
+                    for (size_t g = 0; g < ngroups; g++) {
+                        if (groups->has_values(order[g], i)) {
+                            col->push_back((int)groups->aggregate(order[g], i, agg));
+                        } else {
+                            col->append_missing();
+                        }
+                    }
+                    df->add_column(col, nullptr);
+                } else {
+                    FloatColumn* col = new FloatColumn();
+                    for (size_t g = 0; g < ngroups; g++) {
+                        if (groups->has_values(order[g], i)) {
+                            col->push_back((float)groups->aggregate(order[g], i, agg));
+                        } else {
+                            col->append_missing();
+                        }
+                    }
+                    df->add_column(col, nullptr);
+                }
+            }
+            delete[] order;
+            delete[] vals;
+            return df;
+        }
+
+        /** Returns the inner equi-join of this dataframe with right on the
+          * int or string columns key_col of this frame and right_key of
+          * right, which must have the same type: a new dataframe with this
+          * frame's columns followed by right's, and one row per pair of rows
+          * with equal keys, in the order of this frame's rows and then of
+          * right's. A missing key matches nothing. Column names are kept,
+          * except those of right's columns whose name this frame already
+          * uses. right is external. */
+        DataFrame* inner_join(DataFrame& right, size_t key_col, size_t right_key) {
+            return join_(right, key_col, right_key, false);
+        }
+
+        /** Same as inner_join, but every row of this frame without a match in
+          * right is kept once, paired with missing values. */
+        DataFrame* left_join(DataFrame& right, size_t key_col, size_t right_key) {
+            return join_(right, key_col, right_key, true);
+        }
+
+        /** Returns the permutation that sorts the rows by the given columns:
+          * by the first one, rows with equal values by the second one, and so
+          * on. Row i of the sorted order is row get(i) of this frame. The sort
+          * is ascending and stable, with missing values first. Each column
+          * is sorted in turn, from the last, on the pmap() threads: int,
+          * float, bool and dictionary encoded string columns with a radix
+          * sort, other string columns with a merge sort. The caller owns the
+          * result. */
+        SizeArray* sort_index(size_t* cols, size_t ncols) {
+            exit_if_not(length_ < 0xFFFFFFFF, "Too many rows to sort.");
+            uint32_t* perm = new uint32_t[length_];
+            uint32_t* tmp = new uint32_t[length_];
+            for (size_t i = 0; i < length_; i++) {
+                perm[i] = i;
+            }
+            for (size_t c = ncols; c > 0; c--) {
+                Column* col = column_(cols[c - 1]);
+                if (col->get_type() == 'S' && !col->as_string()->is_dictionary()) {
+                    merge_sort_(col->as_string(), &perm, &tmp);
+                } else {
+                    radix_sort_(col, &perm, &tmp);
+                }
+            }
+            SizeArray* order = new SizeArray();
+            order->resize(length_);
+            for (size_t k = 0; (k << ARRAY_CHUNK_SHIFT) < length_; k++) {
+                size_t* out = order->chunk(k);
+                const uint32_t* in = perm + (k << ARRAY_CHUNK_SHIFT);
+                for (size_t i = 0; i < order->chunk_length(k); i++) {
+                    out[i] = in[i];
+                }
+            }
+            delete[] perm;
+            delete[] tmp;
+            return order;
+        }
+
+        /** Same as sort_index(cols, ncols) for a single column. */
+        SizeArray* sort_index(size_t col) {
+            return sort_index(&col, 1);
+        }
+
+        /** Returns a new dataframe with the rows of this one sorted by the
+          * given columns (see sort_index). Each column is copied once, in
+          * parallel. The result is always such a copy, even when this frame
+          * is a view: only sort_index works on a view in place. The first
+          * sort column of the result is flagged as sorted, which lets
+          * range_view binary search it. */
+        DataFrame* sort(size_t* cols, size_t ncols) {
+            SizeArray* order = sort_index(cols, ncols);
+            if (rows_ != nullptr) {
+                for (size_t i = 0; i < length_; i++) {
+                    order->set(rows_->get(order->get(i)), i);
+                }
+            }
+            DataFrame view(*this, order);
+            DataFrame* df = view.materialize();
+            if (ncols > 0) df->column_(cols[0])->set_sorted(true);
+            return df;
+        }
+
+        /** Same as sort(cols, ncols) for a single column. */
+        DataFrame* sort(size_t col) {
+            return sort(&col, 1);
+        }
+
+        /** Returns a view (see filter_view) of the rows whose value in the int
+          * column col is between lo and hi, inclusive, in order. If the column
+          * is flagged as sorted (see sort), has no missing values and this
+          * frame is not a view, the rows are found by binary search;
+          * otherwise every row is checked, and missing values are left out.
+          * On a view, the rows are checked through its selection and the
+          * result is a view of the same frame, so nothing is copied. */
+        DataFrame* range_view(size_t col, int lo, int hi) {
+            return range_view_(int_column_(col), lo, hi);
+        }
+
+        /** Same as range_view for a float column. */
+        DataFrame* range_view(size_t col, float lo, float hi) {
+            return range_view_(float_column_(col), lo, hi);
+        }
+
+        /** Private function behind range_view, for an int or float column. */
+        template <class C, class T>
+        DataFrame* range_view_(C* col, T lo, T hi) {
+            SizeArray* rows = new SizeArray();
+            if (rows_ == nullptr && col->is_sorted() && col->get_validity() == nullptr) {
+                size_t first = bound_(col, lo, false);
+                size_t end = bound_(col, hi, true);
+                rows->reserve(end > first ? end - first : 0);
+                for (size_t i = first; i < end; i++) {
+                    rows->append(i);
+                }
+            } else {
+                for (size_t i = 0; i < length_; i++) {
+                    size_t row = row_(i);
+                    T val = col->get(row);
+                    if (lo <= val && val <= hi && !col->is_missing(row)) rows->append(row);
+                }
+            }
+            return new DataFrame(*this, rows);
+        }
+
+        /** Private function that returns the first row of the sorted column
+          * col whose value is at least val, or more than val if after. */
+        template <class C, class T>
+        size_t bound_(C* col, T val, bool after) {
+            size_t lo = 0;
+            size_t hi = length_;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                T cur = col->get(mid);
+                if (after ? cur <= val : cur < val) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+
+        /** Private function that stably sorts the permutation *perm of this
+          * frame's rows by col, an int, float, bool or dictionary encoded
+          * string column, with a parallel least significant digit radix sort
+          * of RADIX_BITS bits per pass (see RadixPassTask). Passes over a
+          * digit that all keys share are skipped. Missing values are then
+          * moved to the front, keeping their order. *tmp is scratch space of
+          * the same size, and the two may be swapped. */
+        void radix_sort_(Column* col, uint32_t** perm, uint32_t** tmp) {
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = threads_for_(nchunks);
+            uint32_t* ranks = nullptr;
+            if (col->get_type() == 'S') ranks = SortKeysTask::dictionary_ranks(col->as_string());
+            uint32_t* keys = new uint32_t[length_];
+            uint32_t* keys_tmp = new uint32_t[length_];
+            SortKeysTask make_keys(col, rows_, *perm, keys, ranks, length_, n);
+            run_task_(&make_keys, n);
+            size_t* counts = new size_t[nchunks * RADIX_BUCKETS];
+            for (size_t shift = 0; shift < 32; shift += RADIX_BITS) {
+                RadixPassTask counting(keys, *perm, keys_tmp, *tmp, counts, shift, false, length_, n);
+                run_task_(&counting, n);
+                // Turn the counts into positions, bucket by bucket
+                bool skip = false;
+                size_t pos = 0;
+                for (size_t b = 0; b < RADIX_BUCKETS; b++) {
+                    size_t start = pos;
+                    for (size_t k = 0; k < nchunks; k++) {
+                        size_t count = counts[k * RADIX_BUCKETS + b];
+                        counts[k * RADIX_BUCKETS + b] = pos;
+                        pos += count;
+                    }
+                    if (pos - start == length_) skip = true;
+                }
+                if (skip) continue;
+                RadixPassTask scatter(keys, *perm, keys_tmp, *tmp, counts, shift, true, length_, n);
+                run_task_(&scatter, n);
+                std::swap(keys, keys_tmp);
+                std::swap(*perm, *tmp);
+            }
+            delete[] counts;
+            delete[] keys;
+            delete[] keys_tmp;
+            delete[] ranks;
+            // A dictionary encoded column already puts them first
+            if (col->get_type() != 'S' && col->get_validity() != nullptr) {
+                size_t pos = 0;
+                for (size_t i = 0; i < length_; i++) {
+                    if (col->is_missing(row_((*perm)[i]))) (*tmp)[pos++] = (*perm)[i];
+                }
+                for (size_t i = 0; i < length_; i++) {
+                    if (!col->is_missing(row_((*perm)[i]))) (*tmp)[pos++] = (*perm)[i];
+                }
+                std::swap(*perm, *tmp);
+            }
+        }
+
+        /** Private function that stably sorts the permutation *perm of this
+          * frame's rows by the strings of col with a parallel merge sort (see
+          * MergeSortTask): runs of ARRAY_CHUNK_SIZE rows are sorted, then
+          * pairs of runs are merged until one is left. *tmp is scratch space
+          * of the same size, and the two may be swapped. */
+        void merge_sort_(StringColumn* col, uint32_t** perm, uint32_t** tmp) {
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = threads_for_(nchunks);
+            MergeSortTask runs(col, rows_, *perm, *tmp, length_, 0, n);
+            run_task_(&runs, n);
+            for (size_t width = ARRAY_CHUNK_SIZE; width < length_; width *= 2) {
+                size_t m = threads_for_((length_ + 2 * width - 1) / (2 * width));
+                MergeSortTask merge(col, rows_, *perm, *tmp, length_, width, m);
+                run_task_(&merge, m);
+                std::swap(*perm, *tmp);
+            }
+        }
+
+        /** Private function that joins this frame with right (see JoinTable):
+          * right's keys are hashed into partitions and each partition is
+          * indexed on its own, both in parallel; this frame's keys are then
+          * looked up a chunk at a time, also in parallel, and the matching
+          * rows of both frames are copied into the new frame. Either frame
+          * may be a view, whose rows are read through its selection. */
+        DataFrame* join_(DataFrame& right, size_t key_col, size_t right_key, bool outer) {
+            Column* key = column_(key_col);
+            Column* build_key = right.column_(right_key);
+            exit_if_not(key->get_type() == 'I' || key->get_type() == 'S',
+                        "Can only join on an int or string column.");
+            exit_if_not(key->get_type() == build_key->get_type(), "Join keys must have the same type.");
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t build_chunks = (right.length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = threads_for_(nchunks > build_chunks ? nchunks : build_chunks);
+
+            // Build
+            JoinTable table(build_key, right.rows_, right.length_, n);
+            PartitionTask count(&table, false, n);
+            run_task_(&count, n);
+            table.plan();
+            PartitionTask scatter(&table, true, n);
+            run_task_(&scatter, n);
+            BuildTask build(&table, n);
+            run_task_(&build, n);
+
+            // Probe, then list the matches of every chunk one after the other
+            ProbeTask probe(&table, key, rows_, length_, outer, nchunks, n);
+            run_task_(&probe, n);
+            SizeArray lefts;
+            SizeArray rights;
+            for (size_t k = 0; k < nchunks; k++) {
+                lefts.append_storage(probe.lefts_[k]);
+                rights.append_storage(probe.rights_[k]);
+            }
+            size_t total = lefts.size();
+
+            // Copy the matching rows
+            Schema schema;
+            for (size_t j = 0; j < ncols(); j++) {
+                schema.add_column(schema_->col_type(j), schema_->col_name(j));
+            }
+            for (size_t j = 0; j < right.ncols(); j++) {
+                String* name = right.schema_->col_name(j);
+                if (name != nullptr && schema.col_idx(name->c_str()) >= 0) name = nullptr;
+                schema.add_column(right.schema_->col_type(j), name);
+            }
+            DataFrame* df = new DataFrame(schema);
+            size_t width = ncols() + right.ncols();
+            Column** src = new Column*[width];
+            Column** dst = new Column*[width];
+            for (size_t j = 0; j < width; j++) {
+                src[j] = j < ncols() ? column_(j) : right.column_(j - ncols());
+                dst[j] = static_cast<Column*>(df->columns_->get(j));
+                prepare_copy_(src[j], dst[j], total);
+            }
+            n = threads_for_((total + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE);
+            TakeTask take_left(src, dst, ncols(), &lefts, total, false, n);
+            run_task_(&take_left, n);
+            TakeTask take_right(src + ncols(), dst + ncols(), right.ncols(), &rights, total, outer,
+                                n);
+            run_task_(&take_right, n);
+            df->length_ = total;
+            delete[] src;
+            delete[] dst;
+            return df;
+        }
+
         /** Create a new dataframe, constructed from rows for which the given Rower
           * returned true from its accept method. */
         DataFrame* filter(Rower& r) {
@@ -320,6 +1603,229 @@ class DataFrame : public Object {
             return df;
         }
         
+        /** Same as filter(r), but the rows are checked in parallel on the
+          * pmap() threads and the frame is built a column at a time. The rows
+          * are cut into chunks of ARRAY_CHUNK_SIZE, each checked with its own
+          * clone of r through a RowView, and the outcome is kept in a bitmap.
+          * The selected rows of each column are then copied into the new
+          * frame in their original order, an int or float column one chunk
+          * per thread. The clones are joined into r in chunk order, as in
+          * pmap(). Nothing is allocated per row. */
+        DataFrame* pfilter(Rower& r) {
+            if (rows_ != nullptr) {
+                // The selected rows of a view are scattered, so list them first
+                DataFrame* view = filter_view(r);
+                DataFrame* df = view->materialize();
+                delete view;
+                return df;
+            }
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = threads_for_(nchunks);
+            BoolArray sel;
+            size_t* starts = new size_t[nchunks];
+            size_t total = select_(r, &sel, starts, nchunks, n);
+            DataFrame* df = gather_(&sel, starts, total, nchunks, n);
+            delete[] starts;
+            return df;
+        }
+
+        /** Create a new dataframe from the rows that pass the given predicate,
+          * in order. The predicate is checked against the schema, evaluated
+          * into a bitmap on the pmap() threads one chunk of ARRAY_CHUNK_SIZE
+          * rows at a time, and the selected rows are copied as in
+          * pfilter(r). */
+        DataFrame* filter(Predicate& p) {
+            if (rows_ != nullptr) {
+                DataFrame* view = filter_view(p);
+                DataFrame* df = view->materialize();
+                delete view;
+                return df;
+            }
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = threads_for_(nchunks);
+            BoolArray sel;
+            size_t* starts = new size_t[nchunks];
+            size_t total = select_(p, &sel, starts, nchunks, n);
+            DataFrame* df = gather_(&sel, starts, total, nchunks, n);
+            delete[] starts;
+            return df;
+        }
+
+        /** Like pfilter(r), but instead of copying the selected rows, returns
+          * a view of them: a frame that reads this frame's columns through a
+          * selection vector (see is_view). Only the selection vector is
+          * allocated. map, pmap, the filters, stats and prefix_sum all work on
+          * a view, and materialize() turns it into a frame of its own. The
+          * view must be deleted before this frame, and values set through
+          * either of them are seen by both. */
+        DataFrame* filter_view(Rower& r) {
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            BoolArray sel;
+            size_t* starts = new size_t[nchunks];
+            size_t total = select_(r, &sel, starts, nchunks, threads_for_(nchunks));
+            delete[] starts;
+            return view_(&sel, total);
+        }
+
+        /** Like filter(p), but returns a view of the selected rows, as
+          * filter_view(r) does. */
+        DataFrame* filter_view(Predicate& p) {
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            BoolArray sel;
+            size_t* starts = new size_t[nchunks];
+            size_t total = select_(p, &sel, starts, nchunks, threads_for_(nchunks));
+            delete[] starts;
+            return view_(&sel, total);
+        }
+
+        /** Returns a new frame holding a copy of every row of this frame, in
+          * order, which for a view copies the rows it selects. The columns are
+          * copied in parallel, an int or float column one chunk per thread. */
+        DataFrame* materialize() {
+            Column** src = new Column*[ncols()];
+            Column** dst = new Column*[ncols()];
+            DataFrame* df = empty_copy_(src, dst, length_);
+            size_t nchunks = (length_ + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE;
+            size_t n = threads_for_(nchunks);
+            TakeTask take(src, dst, ncols(), rows_, length_, false, n);
+            run_task_(&take, n);
+            df->length_ = length_;
+            delete[] src;
+            delete[] dst;
+            return df;
+        }
+
+        /** Returns the number of threads to split nchunks units of work on. */
+        size_t threads_for_(size_t nchunks) {
+            size_t n = nthreads_ == 0 ? ThreadPool::default_size() : nthreads_;
+            return n > nchunks ? nchunks : n;
+        }
+
+        /** Checks every row with r on n threads, split into nchunks chunks of
+          * ARRAY_CHUNK_SIZE rows (see SelectTask). Sizes sel to the number of
+          * rows and sets the bit of every row r accepts, stores the number of
+          * selected rows before each chunk in starts, and returns the number
+          * of selected rows. */
+        size_t select_(Rower& r, BoolArray* sel, size_t* starts, size_t nchunks, size_t n) {
+            for (size_t j = 0; j < ncols(); j++) {
+                column_(j);
+            }
+            Rower** rowers = new Rower*[nchunks];
+            for (size_t k = 0; k < nchunks; k++) {
+                rowers[k] = n <= 1 || k == 0 ? &r : dynamic_cast<Rower*>(r.clone());
+            }
+            sel->resize_bits(length_);
+            SelectTask select(columns_, schema_, length_, rows_, rowers, sel, starts, nchunks, n);
+            run_task_(&select, n);
+            if (n > 1) {
+                for (size_t k = 1; k < nchunks; k++) {
+                    r.join_delete(rowers[k]);
+                }
+            }
+            delete[] rowers;
+            return count_starts_(starts, nchunks);
+        }
+
+        /** Like select_(r, ...), but evaluates the predicate p, which is
+          * first checked against the schema (see PredicateTask). */
+        size_t select_(Predicate& p, BoolArray* sel, size_t* starts, size_t nchunks, size_t n) {
+            p.check(*schema_);
+            Column** cols = new Column*[ncols()];
+            for (size_t j = 0; j < ncols(); j++) {
+                cols[j] = column_(j);
+            }
+            sel->resize_bits(length_);
+            PredicateTask select(&p, cols, rows_, length_, sel, starts, nchunks, n);
+            run_task_(&select, n);
+            delete[] cols;
+            return count_starts_(starts, nchunks);
+        }
+
+        /** Turns the number of selected rows of each of the nchunks chunks in
+          * starts into the number selected before it, and returns the total. */
+        size_t count_starts_(size_t* starts, size_t nchunks) {
+            size_t total = 0;
+            for (size_t k = 0; k < nchunks; k++) {
+                size_t count = starts[k];
+                starts[k] = total;
+                total += count;
+            }
+            return total;
+        }
+
+        /** Returns a new frame holding a copy of the total rows whose bit is
+          * set in sel, with starts as filled by select_, copied on n
+          * threads. */
+        DataFrame* gather_(BoolArray* sel, size_t* starts, size_t total, size_t nchunks, size_t n) {
+            Column** src = new Column*[ncols()];
+            Column** dst = new Column*[ncols()];
+            DataFrame* df = empty_copy_(src, dst, total);
+            GatherTask gather(src, dst, ncols(), sel, starts, nchunks, n);
+            run_task_(&gather, n);
+            df->length_ = total;
+            delete[] src;
+            delete[] dst;
+            return df;
+        }
+
+        /** Returns a view of the total rows whose bit is set in sel. */
+        DataFrame* view_(BoolArray* sel, size_t total) {
+            SizeArray* rows = new SizeArray();
+            rows->reserve(total);
+            SetBitIterator it(sel);
+            while (it.has_next()) {
+                rows->append(row_(it.next()));
+            }
+            return new DataFrame(*this, rows);
+        }
+
+        /** Returns a frame with the columns of this frame but no rows, and
+          * stores this frame's columns in src and the new frame's in dst. The
+          * int and float columns of the new frame are sized to length rows,
+          * to be filled in place. */
+        DataFrame* empty_copy_(Column** src, Column** dst, size_t length) {
+            DataFrame* df = new DataFrame(*schema_);
+            for (size_t j = 0; j < ncols(); j++) {
+                src[j] = column_(j);
+                dst[j] = static_cast<Column*>(df->columns_->get(j));
+                prepare_copy_(src[j], dst[j], length);
+            }
+            return df;
+        }
+
+        /** Readies dst, an empty column of the type of src, to receive length
+          * rows of src from a CopyRowsTask: an int or float column is sized
+          * to length, a bool column makes room for it, and a string column is
+          * dictionary encoded if src is. */
+        static void prepare_copy_(Column* src, Column* dst, size_t length) {
+            switch (dst->get_type()) {
+                case 'I':
+                    dst->as_int()->get_fields()->resize(length);
+                    break;
+                case 'F':
+                    dst->as_float()->get_fields()->resize(length);
+                    break;
+                case 'B':
+                    dst->as_bool()->get_fields()->reserve(length);
+                    break;
+                case 'S':
+                    if (src->as_string()->is_dictionary()) {
+                        dst->as_string()->encode_dictionary(0);
+                    }
+                    break;
+            }
+        }
+
+        /** Runs the given task on n threads of the pool, or on this thread if
+          * n is at most 1. */
+        void run_task_(ChunkTask* task, size_t n) {
+            if (n <= 1) {
+                task->run_task(0);
+            } else {
+                get_pool(n)->run(task);
+            }
+        }
+
         /** Print the dataframe in SoR format to standard output. */
         void print() {
             PrintRower* pr = new PrintRower();
@@ -328,32 +1834,37 @@ class DataFrame : public Object {
             delete pr;
         }
 
-        /** Getter for the dataframe's columns. */
+        /** Getter for the dataframe's columns. Lazily loaded columns are
+          * loaded first. A view has no columns of its own, materialize() it
+          * first. */
         Array* get_columns() {
+            exit_if_not(rows_ == nullptr, "Cannot get the columns of a view.");
+            for (size_t i = 0; i < columns_->size(); i++) {
+                column_(i);
+            }
             return columns_;
         }
 
-        /** Pads the given column with a default value until its length
+        /** Returns the column at the given index, loading it first if it is
+          * loaded lazily. */
+        Column* column_(size_t idx) {
+            Column* col = static_cast<Column*>(columns_->get(idx));
+            col->materialize();
+            return col;
+        }
+
+        /** Pads the given column with missing values until its length
          *  matches the number of rows in the data frame. */
         void pad_column(Column* col) {
-            char type = col->get_type();
-            while (col->size() < length_) {
-                switch(type) {
-                    case 'I':
-                        col->append_missing();
-                        break;
-                    case 'B':
-                        col->append_missing();
-                        break;
-                    case 'F':
-                        col->append_missing();
-                        break;
-                    case 'S':
-                        col->append_missing();
-                        break;
-                    default:
-                        exit_if_not(false, "Invalid column type.");
-                }
-            }
+            if (col->length() >= length_) return;
+            col->materialize();
+            col->fill_missing(length_ - col->size());
         }
 };
+
+inline void PmapTask::run_chunk(size_t chunk) {
+    size_t start = chunk * chunk_rows_;
+    size_t end = start + chunk_rows_;
+    if (end > df_->nrows()) end = df_->nrows();
+    df_->map_x(rowers_[chunk], start, end);
+}
@@ -6,12 +6,25 @@
 #include <assert.h>
 
 #include "modified_dataframe.h"
+#include "mapped_file.h"
 
 /**
  * The maximum allowed length for string columns.
  */
 constexpr const size_t MAX_STRING = 255;
 
+/**
+ * The number of pieces per worker that the newline count of a parallel parse is split into. Finding
+ * a row boundary rescans one piece on the calling thread, so pieces are kept small.
+ */
+constexpr const size_t PARSE_PIECES_PER_THREAD = 64;
+
+/**
+ * The number of lines SorParser::parseChunk parses between two checks of how much memory the chunk
+ * takes up.
+ */
+constexpr const size_t STREAM_CHECK_LINES = 256;
+
 /**
  * Represents a fixed-size set of columns of potentially different types.
  */
@@ -45,6 +58,19 @@ class ColumnSet : public Object {
         delete[] _columns;
     }
 
+    /**
+     * @return Roughly how many bytes the columns take up (see Column::footprint)
+     */
+    virtual size_t footprint() {
+        size_t bytes = 0;
+        for (size_t i = 0; i < _length; i++) {
+            if (_columns[i] != nullptr) {
+                bytes += _columns[i]->footprint();
+            }
+        }
+        return bytes;
+    }
+
     /**
      * Gets the number of columns that can be held in this ColumnSet.
      * @return The number of columns
@@ -75,6 +101,18 @@ class ColumnSet : public Object {
         return _columns[which];
     }
 
+    /**
+     * Gives up ownership of the column with the given index. initializeColumn must have been
+     * called for this index first, and the column can no longer be retrieved from this set.
+     * @param which The column index to release
+     * @return The column with the given index. Caller must free.
+     */
+    virtual Column* releaseColumn(size_t which) {
+        Column* col = getColumn(which);
+        _columns[which] = nullptr;
+        return col;
+    }
+
     /**
      * Creates the right subclass of BaseColumn based on the given type.
      * @param type The type of column to create
@@ -191,38 +229,40 @@ class StrSlice : public Object {
      * @return The float
      */
     virtual float toFloat() {
-        // It's hard to roll a float parsing function by hand, so bite the bullet and allocate a
-        // null-terminated string for atof.
-        char* cstr = toCString();
-        float result = atof(cstr);
-        delete[] cstr;
-        return result;
+        // It's hard to roll a float parsing function by hand, so copy the slice into a
+        // null-terminated buffer for atof, on the stack unless the slice is unusually long.
+        char buf[64];
+        size_t length = _end - _start;
+        if (length >= sizeof(buf)) {
+            char* cstr = toCString();
+            float result = atof(cstr);
+            delete[] cstr;
+            return result;
+        }
+        memcpy(buf, getChars(), length);
+        buf[length] = '\0';
+        return atof(buf);
     }
 };
 
 /**
- * This class is capable of reading a given file line-by-line in a semi-efficient manner.
- * Additionally, it can be constrained to a given start and end position in the file, and will
- * discard the first and last (possibly partial) lines in this case.
+ * This class reads a given file line-by-line straight out of a memory mapping of the file, handing
+ * out pointers into the mapping instead of copying each line. Additionally, it can be constrained
+ * to a given start and end position in the file, and will discard the first and last (possibly
+ * partial) lines in this case.
  */
 class LineReader : public Object {
    public:
-    /** Temporary buffer for file contents */
-    char _buf[4096];
-    size_t _buf_length;
-    /** Current position in buffer */
-    size_t _pos;
-    /** The file we're reading from */
-    FILE* _file;
+    /** The mapped file we're reading from */
+    MappedFile* _map;
+    /** Whether we mapped the file ourselves and must unmap it */
+    bool _owns_map;
     /** Byte indices for start, end, and total file size */
     size_t _file_start;
     size_t _file_end;
     size_t _file_size;
-    /** Heap-allocated current line being built by readLine() */
-    char* _current_line;
-    size_t _current_line_size;
-    /** Total number of bytes read so far */
-    size_t _read_size;
+    /** Byte index of the next unread character */
+    size_t _pos;
 
     /**
      * Constructs a new LineReader.
@@ -232,155 +272,94 @@ class LineReader : public Object {
      * @param file_size The total size of the file (as obtained by e.g. ftell)
      */
     LineReader(FILE* file, size_t file_start, size_t file_end, size_t file_size) : Object() {
-        _file = file;
-        _file_start = file_start;
-        _file_end = file_end;
-        _file_size = file_size;
-        fseek(file, file_start, SEEK_SET);
-        _current_line = nullptr;
-        _current_line_size = 0;
-        _pos = 0;
-        _buf_length = 0;
-        _read_size = 0;
+        _map = new MappedFile(file);
+        _owns_map = true;
+        _init(file_start, file_end, file_size);
+    }
+
+    /**
+     * Constructs a new LineReader over an already mapped file.
+     * @param map The mapped file to read from. Must outlive this reader
+     * @param file_start the starting index (of bytes in the file)
+     * @param file_end The ending index
+     */
+    LineReader(MappedFile* map, size_t file_start, size_t file_end) : Object() {
+        _map = map;
+        _owns_map = false;
+        _init(file_start, file_end, map->getSize());
     }
 
     /**
      * Destructor for LineReader
      */
     virtual ~LineReader() {
-        if (_current_line != nullptr) {
-            delete[] _current_line;
+        if (_owns_map) {
+            delete _map;
         }
     }
 
     /**
-     * Null-terminates the current line being built and returns it, setting the _current_line
-     * member to null. Ownership of the line is transferred to the caller.
-     * @return A new null terminated string for the completed line
+     * Shared constructor logic.
      */
-    virtual char* _get_current_line() {
-        if (_current_line == nullptr) {
-            return nullptr;
-        }
-
-        char* line = _current_line;
-        line[_current_line_size] = '\0';
-        _current_line_size = 0;
-        _current_line = nullptr;
-        return line;
+    virtual void _init(size_t file_start, size_t file_end, size_t file_size) {
+        _file_start = file_start;
+        _file_end = file_end;
+        _file_size = file_size;
+        _pos = file_start;
+        _map->advise(_file_start, _file_end, MADV_SEQUENTIAL);
     }
 
     /**
-     * Appends a given section of the given string to the _current_line member.
-     * @param src The string to use
-     * @param start The starting index in the string to copy from
-     * @param end The ending index in the string to copy up to
+     * @return The index one past the last byte we may read
      */
-    virtual void _append_current_line(const char* src, size_t start, size_t end) {
-        char* new_line;
-        size_t copy_pos;
-        if (_current_line == nullptr) {
-            // Allocated a new heap buffer for the line
-            new_line = new char[(end - start) + 1];
-            _current_line_size = (end - start);
-            copy_pos = 0;
-        } else {
-            // Expand the existing buffer
-            new_line = new char[_current_line_size + (end - start) + 1];
-            memcpy(new_line, _current_line, _current_line_size);
-            copy_pos = _current_line_size;
-            _current_line_size += (end - start);
-            delete[] _current_line;
-        }
-
-        memcpy(&new_line[copy_pos], &src[start], end - start);
-        _current_line = new_line;
-    }
+    virtual size_t _limit() { return _file_end < _map->getSize() ? _file_end : _map->getSize(); }
 
     /**
-     * The main method implemented by this type. Reads the next full line out of the file. If
-     * starting from a nonzero offset or ending before the end of the file, the first and last
-     * lines respectively are skipped.
-     * @return The next line, or nullptr if we are out of lines
+     * The main method implemented by this type. Finds the next full line in the file. If starting
+     * from a nonzero offset or ending before the end of the file, the first and last lines
+     * respectively are skipped. The line is not copied: the result points into the mapped file,
+     * is not null-terminated, and stays valid for as long as the file is mapped.
+     * @param length Set to the length of the line, excluding the newline
+     * @return The start of the next line, or nullptr if we are out of lines
      */
-    virtual char* readLine() {
-        bool skip_line = _read_size == 0 && _file_start != 0;
+    virtual const char* readLine(size_t* length) {
+        const char* data = _map->getData();
+        size_t limit = _limit();
 
-        while (true) {
-            // If we need more data from the file, read it
-            if (_pos >= _buf_length) {
-                // If the file is over, we're done
-                if (_read_size >= _file_end - _file_start || feof(_file) || ferror(_file)) {
-                    char* line = _get_current_line();
-                    // If a -len was provided that is less than the file size, skip the last line
-                    if (_file_end != _file_size) {
-                        if (line != nullptr) {
-                            delete[] line;
-                        }
-                        return nullptr;
-                    }
-                    return line;
-                }
+        // If we started after 0, skip the first line we read as it may be partial. Without a
+        // newline, the whole window is part of that line
+        if (_pos == _file_start && _file_start != 0 && _pos < limit) {
+            const char* newline =
+                static_cast<const char*>(memchr(&data[_pos], '\n', limit - _pos));
+            _pos = newline == nullptr ? limit : newline - data + 1;
+        }
 
-                // Read up to sizeof buf data from the file
-                size_t to_read = sizeof(_buf) / sizeof(char);
-                // If we're up to the requested end position, only read as much as necessary
-                if (_file_start + to_read > _file_end) {
-                    to_read -= (_file_start + to_read) - _file_end;
-                }
-                _buf_length = fread(_buf, sizeof(char), to_read, _file);
-                _read_size += _buf_length;
-
-                // Start processing at the beginning of the buffer
-                _pos = 0;
-                if (_buf_length == 0) {
-                    // If fread returned zero, go back to the start of the loop to check for
-                    // feof/ferror and otherwise try reading again
-                    continue;
-                }
-            }
+        if (_pos >= limit) {
+            return nullptr;
+        }
 
-            // Search for the next newline in the current buffer, and return the completed line
-            // if we find one
-            size_t start = _pos;
-            for (size_t i = start; i < _buf_length; i++) {
-                char c = _buf[i];
-                if (c == '\n') {
-                    _append_current_line(_buf, start, i);
-                    _pos = i + 1;
-
-                    // If we started after 0, skip the first line we read as it may be partial
-                    if (skip_line) {
-                        skip_line = false;
-                        delete[] _get_current_line();
-                        start = i + 1;
-                        continue;
-                    }
-
-                    return _get_current_line();
-                }
+        const char* line = &data[_pos];
+        const char* newline = static_cast<const char*>(memchr(line, '\n', limit - _pos));
+        if (newline == nullptr) {
+            // The rest of the input has no newline. If a -len was provided that is less than the
+            // file size, skip this last line
+            _pos = limit;
+            if (_file_end != _file_size) {
+                return nullptr;
             }
-            // If no newline found, loop around and read more file data
-            _append_current_line(_buf, start, _buf_length);
-            _pos = _buf_length;
+            *length = limit - (line - data);
+            return line;
         }
+        *length = newline - line;
+        _pos = newline - data + 1;
+        return line;
     }
 
     /**
      * Resets this reader. Goes back to the start position and prepares to read lines from there
      * again.
      */
-    virtual void reset() {
-        if (_current_line != nullptr) {
-            delete[] _current_line;
-        }
-        _current_line = nullptr;
-        _current_line_size = 0;
-        fseek(_file, _file_start, SEEK_SET);
-        _pos = 0;
-        _buf_length = 0;
-        _read_size = 0;
-    }
+    virtual void reset() { _pos = _file_start; }
 };
 
 /**
@@ -395,6 +374,111 @@ enum class ParserMode {
     PARSE_FILE
 };
 
+/**
+ * Task that counts the newlines in equal-sized pieces of a byte range, in parallel.
+ */
+class NewlineCountTask : public ChunkTask {
+   public:
+    /** The bytes to scan (external) and the range of them to count in */
+    const char* _data;
+    size_t _start;
+    size_t _end;
+    /** The number of newlines in each piece */
+    size_t* _counts;
+
+    /**
+     * Creates a new NewlineCountTask.
+     * @param data The bytes to scan
+     * @param start The first byte of the range
+     * @param end One past the last byte of the range
+     * @param pieces The number of pieces to split the range into
+     * @param nworkers The number of workers that will run the task
+     */
+    NewlineCountTask(const char* data, size_t start, size_t end, size_t pieces, size_t nworkers)
+        : ChunkTask(pieces, nworkers) {
+        _data = data;
+        _start = start;
+        _end = end;
+        _counts = new size_t[pieces];
+    }
+
+    /**
+     * Destructor for NewlineCountTask
+     */
+    virtual ~NewlineCountTask() { delete[] _counts; }
+
+    /**
+     * @return The first byte of the given piece
+     */
+    virtual size_t pieceStart(size_t piece) { return _start + (_end - _start) * piece / nchunks_; }
+
+    /**
+     * Counts the newlines in the given piece.
+     */
+    virtual void run_chunk(size_t piece) {
+        const char* pos = &_data[pieceStart(piece)];
+        const char* end = &_data[pieceStart(piece + 1)];
+        size_t count = 0;
+        while (pos < end) {
+            pos = static_cast<const char*>(memchr(pos, '\n', end - pos));
+            if (pos == nullptr) {
+                break;
+            }
+            count++;
+            pos++;
+        }
+        _counts[piece] = count;
+    }
+};
+
+class SorParser;
+
+/**
+ * Task that parses disjoint byte windows of a file into one ColumnSet per window, in parallel.
+ */
+class ParseTask : public ChunkTask {
+   public:
+    /** The parser whose schema is used (external) */
+    SorParser* _parser;
+    /** The byte window of each segment, as passed to LineReader */
+    size_t* _starts;
+    size_t* _ends;
+    /** The parsed columns of each segment */
+    ColumnSet** _sets;
+    /** The line start offsets of each segment, when the parser records them */
+    SizeArray** _lines;
+
+    /**
+     * Creates a new ParseTask. The windows and sets are filled in by the caller.
+     * @param parser The parser to parse with
+     * @param segments The number of windows
+     * @param nworkers The number of workers that will run the task
+     */
+    ParseTask(SorParser* parser, size_t segments, size_t nworkers)
+        : ChunkTask(segments, nworkers) {
+        _parser = parser;
+        _starts = new size_t[segments];
+        _ends = new size_t[segments];
+        _sets = new ColumnSet*[segments];
+        _lines = new SizeArray*[segments];
+    }
+
+    /**
+     * Destructor for ParseTask. Does not free the sets or line offsets.
+     */
+    virtual ~ParseTask() {
+        delete[] _starts;
+        delete[] _ends;
+        delete[] _sets;
+        delete[] _lines;
+    }
+
+    /**
+     * Parses the given segment.
+     */
+    virtual void run_chunk(size_t segment);
+};
+
 /**
  * Parses a given file into a ColumnSet with BaseColumns representing the sor data in the file.
  */
@@ -425,6 +509,15 @@ class SorParser : public Object {
     char* _typeGuesses;
     /** The number of columns we have detected */
     size_t _num_columns;
+    /** Which columns to parse right away (see setProjection), nullptr for all of them */
+    bool* _projection;
+    /** The offset in the file of every parsed line, only recorded with a projection */
+    SizeArray* _lineStarts;
+    /** Loads the columns left out of the projection, nullptr if there are none */
+    ColumnLoader* _loader;
+    /** Whether parseChunk has started reading the file, and the number of lines it has parsed */
+    bool _streaming;
+    size_t _streamedLines;
 
     /**
      * Creates a new SorParser with the given parameters.
@@ -438,6 +531,11 @@ class SorParser : public Object {
         _columns = nullptr;
         _typeGuesses = nullptr;
         _num_columns = 0;
+        _projection = nullptr;
+        _lineStarts = nullptr;
+        _loader = nullptr;
+        _streaming = false;
+        _streamedLines = 0;
     }
 
     /**
@@ -451,6 +549,12 @@ class SorParser : public Object {
         if (_typeGuesses != nullptr) {
             delete[] _typeGuesses;
         }
+        if (_projection != nullptr) {
+            delete[] _projection;
+        }
+        if (_lineStarts != nullptr) {
+            delete _lineStarts;
+        }
     }
 
     /**
@@ -461,9 +565,19 @@ class SorParser : public Object {
      * @param columns The ColumnSet to add the data to
      */
     virtual void _appendField(StrSlice slice, size_t field_num, ColumnSet* columns) {
-        slice.trim(SPACE);
+        if (_projection == nullptr || _projection[field_num]) {
+            _appendValue(slice, columns->getColumn(field_num));
+        }
+    }
 
-        Column* column = columns->getColumn(field_num);
+    /**
+     * Appends the entry contained in the given StrSlice to the given column, using the type of
+     * the column.
+     * @param slice The slice containing the data for this field
+     * @param column The column to add the data to
+     */
+    static void _appendValue(StrSlice slice, Column* column) {
+        slice.trim(SPACE);
 
         if (slice.getLength() == 0) {
             column->append_missing();
@@ -474,7 +588,9 @@ class SorParser : public Object {
             case 'S':
                 slice.trim(STRING_QUOTE);
                 assert(slice.getLength() <= MAX_STRING);
-                dynamic_cast<StringColumn*>(column)->push_back(new String(slice.toCString()));
+                // Copied straight from the file into the column's arena
+                static_cast<StringColumn*>(column)->push_back_chars(slice.getChars(),
+                                                                    slice.getLength());
                 break;
             case 'I':
                 dynamic_cast<IntColumn*>(column)->push_back(slice.toInt());
@@ -547,43 +663,65 @@ class SorParser : public Object {
     }
 
     /**
-     * Finds and iterates over the deliminated fields in the given line string according to the
-     * given parsing mode.
-     * @param line The line to scan/parse
-     * @param mode The mode to use
-     * @param columns The data representation to update
+     * Finds the next deliminated field in the given line.
+     * @param line The line to scan, not necessarily null-terminated
+     * @param length The length of the line
+     * @param pos The index to start scanning at. Updated to just past the field
+     * @param start Set to the index of the field's first char, after the opening bracket
+     * @param end Set to the index of the field's closing bracket
+     * @return Whether a complete field was found
      */
-    virtual size_t _scanLine(const char* line, ParserMode mode, ColumnSet* columns) {
-        size_t num_fields = 0;
-        size_t this_field_start = 0;
+    static bool _nextField(const char* line, size_t length, size_t* pos, size_t* start,
+                           size_t* end) {
         bool in_field = false;
         bool in_string = false;
-
-        // Iterate over the line, create slices for each detected field, and call either
-        // _guessFieldType for ParserMode::DETECT_SCHEMA or _appendField for ParserMode::PARSE_FILE
-        // for ParserMode::DETECT_NUM_COLUMNS we simply return the number of fields we saw
-        for (size_t i = 0; i < strlen(line); i++) {
+        for (size_t i = *pos; i < length; i++) {
             char c = line[i];
             if (!in_field) {
                 if (c == FIELD_BEGIN) {
                     in_field = true;
-                    this_field_start = i;
+                    *start = i + 1;
                 }
             } else {
                 if (c == STRING_QUOTE) {
                     // Allow > inside quoted strings
                     in_string = !in_string;
                 } else if (c == FIELD_END && !in_string) {
-                    if (mode == ParserMode::DETECT_SCHEMA) {
-                        _guessFieldType(StrSlice(line, this_field_start + 1, i), num_fields);
-                    } else if (mode == ParserMode::PARSE_FILE) {
-                        _appendField(StrSlice(line, this_field_start + 1, i), num_fields, columns);
-                    }
-                    in_field = false;
-                    num_fields++;
+                    *end = i;
+                    *pos = i + 1;
+                    return true;
                 }
             }
         }
+        *pos = length;
+        return false;
+    }
+
+    /**
+     * Finds and iterates over the deliminated fields in the given line string according to the
+     * given parsing mode.
+     * @param line The line to scan/parse, not necessarily null-terminated
+     * @param length The length of the line
+     * @param mode The mode to use
+     * @param columns The data representation to update
+     */
+    virtual size_t _scanLine(const char* line, size_t length, ParserMode mode, ColumnSet* columns) {
+        size_t num_fields = 0;
+        size_t pos = 0;
+        size_t start = 0;
+        size_t end = 0;
+
+        // Iterate over the line, create slices for each detected field, and call either
+        // _guessFieldType for ParserMode::DETECT_SCHEMA or _appendField for ParserMode::PARSE_FILE
+        // for ParserMode::DETECT_NUM_COLUMNS we simply return the number of fields we saw
+        while (_nextField(line, length, &pos, &start, &end)) {
+            if (mode == ParserMode::DETECT_SCHEMA) {
+                _guessFieldType(StrSlice(line, start, end), num_fields);
+            } else if (mode == ParserMode::PARSE_FILE) {
+                _appendField(StrSlice(line, start, end), num_fields, columns);
+            }
+            num_fields++;
+        }
 
         return num_fields;
     }
@@ -597,35 +735,36 @@ class SorParser : public Object {
         assert(_typeGuesses == nullptr);
         // Detect the row with the most fields in the first 500 lines
         size_t max_columns = 0;
+        size_t length;
         for (size_t i = 0; i < GUESS_SCHEMA_LINES; i++) {
-            char* next_line = _reader->readLine();
+            const char* next_line = _reader->readLine(&length);
             if (next_line == nullptr) {
                 break;
             }
-            size_t num_columns = _scanLine(next_line, ParserMode::DETECT_NUM_COLUMNS, nullptr);
+            size_t num_columns =
+                _scanLine(next_line, length, ParserMode::DETECT_NUM_COLUMNS, nullptr);
             if (num_columns > max_columns) {
                 max_columns = num_columns;
             }
-            delete[] next_line;
         }
         assert(max_columns != 0);
 
         // Guess the type for each column
         _reader->reset();
-        _columns = new ColumnSet(max_columns);
-        _typeGuesses = new char[max_columns];
+        _typeGuesses = new char[max_columns + 1];
         _num_columns = max_columns;
         for (size_t i = 0; i < _num_columns; i++) {
             _typeGuesses[i] = 'U';
         }
+        // Null-terminated so it can be handed to the Schema constructor
+        _typeGuesses[_num_columns] = '\0';
 
         for (size_t i = 0; i < GUESS_SCHEMA_LINES; i++) {
-            char* next_line = _reader->readLine();
+            const char* next_line = _reader->readLine(&length);
             if (next_line == nullptr) {
                 break;
             }
-            _scanLine(next_line, ParserMode::DETECT_SCHEMA, nullptr);
-            delete[] next_line;
+            _scanLine(next_line, length, ParserMode::DETECT_SCHEMA, nullptr);
         }
 
         for (size_t i = 0; i < _num_columns; i++) {
@@ -633,8 +772,8 @@ class SorParser : public Object {
                 // Assume bool for anything we still don't have a guess for as per spec
                 _typeGuesses[i] = 'B';
             }
-            _columns->initializeColumn(i, _typeGuesses[i]);
         }
+        _columns = _makeColumnSet();
 
         return new Schema(_typeGuesses);
     }
@@ -647,21 +786,232 @@ class SorParser : public Object {
         assert(_columns != nullptr);
 
         _reader->reset();
+        _parseLines(_reader, _columns, _lineStarts);
+        _attachLoader();
+    }
+
+    /**
+     * Reads the file into a ColumnSet like parseFile(), using up to the given number of threads.
+     * The byte range is cut into one segment per thread on line boundaries, every segment is
+     * parsed into its own ColumnSet, and the segments' column chunks are then handed over to the
+     * final columns in order. When every thread gets at least ARRAY_CHUNK_SIZE rows, segment
+     * boundaries fall on multiples of ARRAY_CHUNK_SIZE rows so that every chunk can be adopted
+     * without copying the values. Smaller files are split evenly instead, and their segments'
+     * values are copied into the final columns (see ChunkedStorage::take_chunks).
+     * guessSchema() must be called before this functions. Can only be called once.
+     * @param nthreads The number of threads to use
+     */
+    virtual void parseFile(size_t nthreads) {
+        assert(_columns != nullptr);
+
+        MappedFile* map = _reader->_map;
+        const char* data = map->getData();
+        size_t limit = _reader->_limit();
+        size_t start = _reader->_file_start;
+        if (nthreads <= 1 || start >= limit) {
+            parseFile();
+            return;
+        }
+
+        // Find where the first row begins. Without a newline, there is at most one line to parse
+        if (start != 0) {
+            const char* newline =
+                static_cast<const char*>(memchr(&data[start], '\n', limit - start));
+            if (newline == nullptr) {
+                parseFile();
+                return;
+            }
+            start = newline - data + 1;
+        }
+
+        ThreadPool pool(nthreads);
+        NewlineCountTask counter(data, start, limit, nthreads * PARSE_PIECES_PER_THREAD, nthreads);
+        pool.run(&counter);
+        size_t newlines = 0;
+        for (size_t i = 0; i < counter.nchunks_; i++) {
+            newlines += counter._counts[i];
+        }
+
+        // Every row but the last one ends with a newline, so cutting after the right newlines
+        // gives each segment the same number of rows. Rounding that up to a multiple of
+        // ARRAY_CHUNK_SIZE would leave a small file with fewer segments than threads, so it's
+        // only done when there are enough rows for every thread to fill a chunk
+        size_t rows_per_segment = (newlines + nthreads - 1) / nthreads;
+        if (rows_per_segment >= ARRAY_CHUNK_SIZE) {
+            rows_per_segment = (rows_per_segment + ARRAY_CHUNK_MASK) & ~ARRAY_CHUNK_MASK;
+        }
+        size_t segments = newlines == 0 ? 1 : (newlines - 1) / rows_per_segment + 1;
+        if (segments <= 1) {
+            parseFile();
+            return;
+        }
+
+        ParseTask task(this, segments, nthreads);
+        size_t piece = 0;
+        size_t seen = 0;
+        task._starts[0] = _reader->_file_start;
+        for (size_t i = 1; i < segments; i++) {
+            // Find the piece holding the wanted newline, then the newline within the piece
+            size_t wanted = i * rows_per_segment;
+            while (seen + counter._counts[piece] < wanted) {
+                seen += counter._counts[piece];
+                piece++;
+            }
+            const char* pos = &data[counter.pieceStart(piece)];
+            for (size_t n = seen; n < wanted; n++) {
+                pos = static_cast<const char*>(memchr(pos, '\n', limit - (pos - data))) + 1;
+            }
+            // Starting the window on the newline itself makes the reader skip just that newline
+            task._ends[i - 1] = pos - data;
+            task._starts[i] = pos - data - 1;
+        }
+        task._ends[segments - 1] = _reader->_file_end;
+        for (size_t i = 0; i < segments; i++) {
+            task._sets[i] = _makeColumnSet();
+            task._lines[i] = _lineStarts == nullptr ? nullptr : new SizeArray();
+        }
+        pool.run(&task);
 
-        char* line;
+        for (size_t i = 0; i < segments; i++) {
+            for (size_t j = 0; j < _num_columns; j++) {
+                _columns->getColumn(j)->move_from(task._sets[i]->getColumn(j));
+            }
+            delete task._sets[i];
+            if (_lineStarts != nullptr) {
+                _lineStarts->take_chunks(task._lines[i]);
+                delete task._lines[i];
+            }
+        }
+        _attachLoader();
+    }
+
+    /**
+     * Parses the next lines of the file into a DataFrame of their own, for files too large to be
+     * held in memory at once. Lines are parsed until the chunk's columns take up about the given
+     * number of bytes (see Column::footprint), checked every STREAM_CHECK_LINES lines. Columns
+     * grow by ARRAY_CHUNK_SIZE values at a time, so a chunk can go over by that much storage per
+     * column. The bytes of the file that were read are then dropped from memory again. Chunks come in file
+     * order and together hold every line parseFile() would have parsed. The row base of each chunk
+     * (see DataFrame::set_row_base) is the number of lines before it, so that Rowers see the
+     * index of every row within the whole file.
+     * guessSchema() must be called before this function, and neither parseFile() nor
+     * setProjection() may be used along with it.
+     * @param max_bytes The number of bytes the columns of one chunk may take up
+     * @return The chunk, or nullptr once the whole file has been parsed. Caller must free.
+     */
+    virtual DataFrame* parseChunk(size_t max_bytes) {
+        assert(_columns != nullptr);
+        assert(_projection == nullptr);
+        if (!_streaming) {
+            _reader->reset();
+            _streaming = true;
+        }
+
+        // Stop once the budget is reached, so every chunk has at least one line
+        size_t begin = _reader->_pos;
+        ColumnSet* columns = _makeColumnSet();
+        const char* line;
+        size_t length;
+        size_t lines = 0;
+        while (lines % STREAM_CHECK_LINES != 0 || lines == 0 || columns->footprint() < max_bytes) {
+            line = _reader->readLine(&length);
+            if (line == nullptr) {
+                break;
+            }
+            size_t scanned_fields = _scanLine(line, length, ParserMode::PARSE_FILE, columns);
+            for (size_t i = scanned_fields; i < _num_columns; i++) {
+                columns->getColumn(i)->append_missing();
+            }
+            lines++;
+        }
+        // The lines were copied into the columns, so their pages are no longer needed
+        _reader->_map->advise(begin, _reader->_pos, MADV_DONTNEED);
+        if (lines == 0) {
+            delete columns;
+            return nullptr;
+        }
+
+        // The columns are external to the chunk, so it holds on to their set to free them with it
+        Schema empty;
+        DataFrame* chunk = new DataFrame(empty);
+        for (size_t i = 0; i < _num_columns; i++) {
+            chunk->add_column(columns->getColumn(i), nullptr);
+        }
+        chunk->add_backing(columns);
+        chunk->set_row_base(_streamedLines);
+        _streamedLines += lines;
+        return chunk;
+    }
+
+    /**
+     * Parses every line the given reader returns into the given ColumnSet, padding short lines
+     * with missing values.
+     * @param reader The reader to read lines from
+     * @param columns The data representation to update
+     * @param starts If not nullptr, the offset of every line in the file is appended to it
+     */
+    virtual void _parseLines(LineReader* reader, ColumnSet* columns, SizeArray* starts) {
+        const char* data = reader->_map->getData();
+        const char* line;
+        size_t length;
         while (true) {
-            line = _reader->readLine();
+            line = reader->readLine(&length);
             if (line == nullptr) {
                 break;
             }
-            size_t scanned_fields = _scanLine(line, ParserMode::PARSE_FILE, _columns);
+            if (starts != nullptr) {
+                starts->append(line - data);
+            }
+            size_t scanned_fields = _scanLine(line, length, ParserMode::PARSE_FILE, columns);
             for (size_t i = scanned_fields; i < _num_columns; i++) {
-                _columns->getColumn(i)->append_missing();
+                if (_projection == nullptr || _projection[i]) {
+                    columns->getColumn(i)->append_missing();
+                }
             }
-            delete[] line;
         }
     }
 
+    /**
+     * Restricts parsing to the given columns. The other columns are left empty by parseFile and
+     * are parsed from the file the first time one of their values is needed (see getLoader).
+     * Must be called after guessSchema() and before parseFile().
+     * @param wanted Whether to parse each column, one entry per column of the guessed schema
+     */
+    virtual void setProjection(bool* wanted) {
+        assert(_columns != nullptr);
+        assert(_projection == nullptr);
+        _projection = new bool[_num_columns];
+        memcpy(_projection, wanted, _num_columns * sizeof(bool));
+        _lineStarts = new SizeArray();
+    }
+
+    /**
+     * Hands the columns that were left out of the projection to a loader that parses them on
+     * demand. The loader takes over the mapped file and the line offsets.
+     */
+    virtual void _attachLoader();
+
+    /**
+     * Gets the loader of the columns that were left out of the projection. It must stay alive as
+     * long as those columns are in use, e.g. by handing it to DataFrame::add_backing.
+     * parseFile() must be called before this function.
+     * @return The loader, or nullptr if every column was parsed. Caller must free.
+     */
+    virtual ColumnLoader* getLoader() { return _loader; }
+
+    /**
+     * Creates an empty ColumnSet with a column of the guessed type for every column.
+     * guessSchema() must have guessed the types first.
+     * @return The new ColumnSet. Caller must free.
+     */
+    virtual ColumnSet* _makeColumnSet() {
+        ColumnSet* columns = new ColumnSet(_num_columns);
+        for (size_t i = 0; i < _num_columns; i++) {
+            columns->initializeColumn(i, _typeGuesses[i]);
+        }
+        return columns;
+    }
+
     /**
      * Gets the in-memory representation for the sor data.
      * guessSchema() and parseFile() must be called before this function.
@@ -671,4 +1021,145 @@ class SorParser : public Object {
 
         return _columns;
     }
-};
\ No newline at end of file
+};
+
+/**
+ * Loads the columns that a SorParser left out of its projection, by parsing just their fields out
+ * of every line again. Each column is loaded on its own, the first time one of its values is
+ * needed.
+ */
+class SorColumnLoader : public ColumnLoader {
+   public:
+    /** The mapped file the lines are read from */
+    MappedFile* _map;
+    /** The index one past the last byte that lines may extend to */
+    size_t _limit;
+    /** The offset of every line in the file, one per row */
+    SizeArray* _starts;
+    /** The columns to load and their index in each line, _count of each */
+    Column** _columns;
+    size_t* _fields;
+    size_t _count;
+    /** Guards the loading of columns */
+    Lock _lock;
+
+    /**
+     * Creates a new SorColumnLoader, which takes ownership of the mapped file and line offsets.
+     * Columns are registered with addColumn.
+     * @param map The mapped file
+     * @param limit The index one past the last byte that lines may extend to
+     * @param starts The offset of every line in the file
+     * @param max_columns The maximum number of columns to register
+     */
+    SorColumnLoader(MappedFile* map, size_t limit, SizeArray* starts, size_t max_columns)
+        : ColumnLoader() {
+        _map = map;
+        _limit = limit;
+        _starts = starts;
+        _columns = new Column*[max_columns];
+        _fields = new size_t[max_columns];
+        _count = 0;
+    }
+
+    /**
+     * Destructor for SorColumnLoader
+     */
+    virtual ~SorColumnLoader() {
+        delete _map;
+        delete _starts;
+        delete[] _columns;
+        delete[] _fields;
+    }
+
+    /**
+     * Makes this loader responsible for the values of the given empty column.
+     * @param col The column
+     * @param field The index of the column's field in each line
+     */
+    virtual void addColumn(Column* col, size_t field) {
+        _columns[_count] = col;
+        _fields[_count] = field;
+        _count++;
+        col->loader_.store(this, std::memory_order_release);
+    }
+
+    /**
+     * @return The number of rows
+     */
+    virtual size_t length() { return _starts->size(); }
+
+    /**
+     * Parses the values of the given column, unless another thread already did.
+     * @param col The column
+     */
+    virtual void load(Column* col) {
+        _lock.lock();
+        if (col->loader_.load(std::memory_order_acquire) == this) {
+            size_t which = 0;
+            while (_columns[which] != col) {
+                which++;
+            }
+            _loadField(col, _fields[which]);
+            col->loader_.store(nullptr, std::memory_order_release);
+        }
+        _lock.unlock();
+    }
+
+    /**
+     * Appends the given field of every line to the given column.
+     * @param col The column
+     * @param field The index of the field in each line
+     */
+    virtual void _loadField(Column* col, size_t field) {
+        const char* data = _map->getData();
+        for (size_t i = 0; i < _starts->size(); i++) {
+            size_t offset = _starts->get(i);
+            const char* line = &data[offset];
+            const char* newline = static_cast<const char*>(memchr(line, '\n', _limit - offset));
+            size_t length = newline == nullptr ? _limit - offset : newline - line;
+
+            size_t pos = 0;
+            size_t start = 0;
+            size_t end = 0;
+            size_t num_fields = 0;
+            bool found = false;
+            while (SorParser::_nextField(line, length, &pos, &start, &end)) {
+                if (num_fields++ == field) {
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                SorParser::_appendValue(StrSlice(line, start, end), col);
+            } else {
+                col->append_missing();
+            }
+        }
+    }
+};
+
+inline void SorParser::_attachLoader() {
+    if (_projection == nullptr) {
+        return;
+    }
+    SorColumnLoader* loader = nullptr;
+    for (size_t i = 0; i < _num_columns; i++) {
+        if (_projection[i]) {
+            continue;
+        }
+        if (loader == nullptr) {
+            // The loader takes over the mapping, which has to outlive the parser
+            loader = new SorColumnLoader(_reader->_map, _reader->_limit(), _lineStarts,
+                                         _num_columns);
+            _reader->_owns_map = false;
+            _lineStarts = nullptr;
+        }
+        loader->addColumn(_columns->getColumn(i), i);
+    }
+    _loader = loader;
+}
+
+inline void ParseTask::run_chunk(size_t segment) {
+    LineReader reader(_parser->_reader->_map, _starts[segment], _ends[segment]);
+    _parser->_parseLines(&reader, _sets[segment], _lines[segment]);
+}
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 
 #include "parser.h"
+#include "binary_file.h"
 
 /**
  * Enum representing different states of parsing command line arguments.
@@ -17,13 +18,25 @@ enum class ParseState {
     FLAG_COL_IDX_COL,
     FLAG_COL_IDX_OFF,
     FLAG_MISSING_IDX_COL,
-    FLAG_MISSING_IDX_OFF
+    FLAG_MISSING_IDX_OFF,
+    FLAG_PARSE_THREADS,
+    FLAG_LOAD_BIN,
+    FLAG_SAVE_BIN,
+    FLAG_COLS,
+    FLAG_STREAM
 };
 
 class ParserMain {
     public:
 
         DataFrame* _df;
+        /** The parser and file that -stream reads chunks from, nullptr unless streaming */
+        SorParser* _parser;
+        FILE* _file;
+        /** The number of bytes the parsed columns of a -stream chunk may take up */
+        size_t _budget;
+        /** The threads pmap() runs every chunk on, kept from one chunk to the next */
+        ThreadPool* _pool;
 
         /**
          * The Constructor, formerly the main function.
@@ -31,6 +44,9 @@ class ParserMain {
         ParserMain(int argc, char* argv[]) {
             // Parse arguments
             char* filename = nullptr;
+            char* load_bin = nullptr;
+            char* save_bin = nullptr;
+            char* cols = nullptr;
             // -1 represents argument not provided
             ssize_t start = -1;
             ssize_t len = -1;
@@ -39,9 +55,23 @@ class ParserMain {
             ssize_t col_idx_off = -1;
             ssize_t missing_idx_col = -1;
             ssize_t missing_idx_off = -1;
+            ssize_t parse_threads = -1;
+            ssize_t stream = -1;
+            _parser = nullptr;
+            _file = nullptr;
+            _pool = nullptr;
 
             parse_args(argc, argv, &filename, &start, &len, &col_type, &col_idx_col, &col_idx_off,
-                    &missing_idx_col, &missing_idx_off);
+                    &missing_idx_col, &missing_idx_off, &parse_threads, &load_bin, &save_bin, &cols,
+                    &stream);
+
+            // A binary file is mapped back in as is, without any parsing
+            if (load_bin != nullptr) {
+                BinaryReader reader{load_bin};
+                _df = reader.getDataFrame();
+                print_missing_idx(missing_idx_col, missing_idx_off);
+                return;
+            }
 
             // Check arguments
             if (filename == nullptr) {
@@ -68,45 +98,72 @@ class ParserMain {
                 len = file_size - start;
             }
 
+            if (parse_threads == -1) {
+                parse_threads = ThreadPool::default_size();
+            }
+
+            // Only the schema is read up front when streaming, map() and pmap() parse the rest
+            if (stream != -1) {
+                // These need the whole file in memory
+                cli_assert(stream > 0 && cols == nullptr && save_bin == nullptr &&
+                           missing_idx_col == -1);
+                _parser = new SorParser(file, (size_t)start, (size_t)start + len, file_size);
+                _file = file;
+                _budget = (size_t)stream;
+                Schema* schema = _parser->guessSchema();
+                _df = new DataFrame(*schema);
+                delete schema;
+                return;
+            }
+
             // Run parsing
             SorParser parser{file, (size_t)start, (size_t)start + len, file_size};
             Schema* schema = parser.guessSchema();
-            _df = new DataFrame(*schema);
-            parser.parseFile();
+            if (cols != nullptr) {
+                bool* wanted = parse_cols_arg(cols, schema->width());
+                parser.setProjection(wanted);
+                delete[] wanted;
+            }
+            parser.parseFile((size_t)parse_threads);
             ColumnSet* set = parser.getColumnSet();
 
-            // Adds the columns to the empty df by creating rows from the array of columns
-            // and adding each row to the df.
-            Row* row = new Row(*schema);
-            int nrows = set->getColumn(0)->size();
-            char type;
-            for (int i = 0; i < nrows; i++) {
-                // Build the row
-                for (int j = 0; j < set->getLength(); j++) {
-                    Column* col = set->getColumn(j);
-                    type = col->get_type();
-                    switch (type) {
-                        case 'I':
-                            row->set(j, col->as_int()->get(i));
-                            break;
-                        case 'B':
-                            row->set(j, col->as_bool()->get(i));
-                            break;
-                        case 'F':
-                            row->set(j, col->as_float()->get(i));
-                            break;
-                        case 'S':
-                            row->set(j, col->as_string()->get(i));
-                            break;
-                        default:
-                            assert(false);
-                    }
-                }
-                _df->add_row(*row);
+            // Hands the parsed columns over to an empty df as they are, so no value is copied
+            Schema empty;
+            _df = new DataFrame(empty);
+            for (size_t i = 0; i < set->getLength(); i++) {
+                _df->add_column(set->releaseColumn(i), nullptr);
+            }
+            // The columns left out of -cols are parsed from the file when first used
+            ColumnLoader* loader = parser.getLoader();
+            if (loader != nullptr) {
+                _df->add_backing(loader);
             }
-            delete row;
+            delete schema;
 
             fclose(file);
+
+            if (save_bin != nullptr) {
+                BinaryWriter writer{_df, save_bin};
+            }
+            print_missing_idx(missing_idx_col, missing_idx_off);
+        }
+
+        /**
+         * Answers -is_missing_idx, if it was given, by printing 1 if the field at the given column
+         * and offset is missing and 0 otherwise.
+         * @param col, off The arguments of -is_missing_idx, -1 if it was not given
+         */
+        void print_missing_idx(ssize_t col, ssize_t off) {
+            if (col == -1 || off == -1) return;
+            if ((size_t)col >= _df->ncols()) {
+                printf("No such column\n");
+                exit(-1);
+            }
+            if ((size_t)off >= _df->nrows()) {
+                printf("No such entry\n");
+                exit(-1);
+            }
+            printf("%d\n", _df->is_missing(col, off) ? 1 : 0);
         }
 
         /**
@@ -114,6 +171,61 @@ class ParserMain {
          */
         ~ParserMain() {
             delete _df;
+            delete _pool;
+            if (_parser != nullptr) {
+                delete _parser;
+                fclose(_file);
+            }
+        }
+
+        /**
+         * @return Whether -stream was given, in which case the DataFrame holds no rows and the
+         * file is only parsed by map() and pmap()
+         */
+        bool streaming() {
+            return _parser != nullptr;
+        }
+
+        /**
+         * Visits every row of the file in order with the given Rower. When streaming, the file is
+         * parsed one chunk at a time (see SorParser::parseChunk), and each chunk is mapped and then
+         * freed before the next one is parsed. -stream bounds the memory of the parsed columns of
+         * a chunk, not that of the Rower, which is up to the Rower. Rows are reported with their
+         * index in the whole file.
+         * Can only be called once when streaming.
+         * @param r The Rower
+         */
+        void map(Rower& r) {
+            if (!streaming()) {
+                _df->map(r);
+                return;
+            }
+            DataFrame* chunk;
+            while ((chunk = _parser->parseChunk(_budget)) != nullptr) {
+                chunk->map(r);
+                delete chunk;
+            }
+        }
+
+        /**
+         * Like map(), but maps each chunk with DataFrame::pmap, whose clones of the given Rower are
+         * joined into it with join_delete as every chunk is done. Every chunk runs on the same
+         * threads.
+         * Can only be called once when streaming.
+         * @param r The Rower
+         */
+        void pmap(Rower& r) {
+            if (!streaming()) {
+                _df->pmap(r);
+                return;
+            }
+            DataFrame* chunk;
+            while ((chunk = _parser->parseChunk(_budget)) != nullptr) {
+                chunk->adopt_pool(_pool);
+                chunk->pmap(r);
+                _pool = chunk->release_pool();
+                delete chunk;
+            }
         }
 
         /**
@@ -138,6 +250,33 @@ class ParserMain {
             *arg_loc = atol(arg);
         }
 
+        /**
+         * Parses the comma separated list of column indices given to -cols. Terminates with an
+         * error print if an index is not a valid column.
+         * @param arg The list, e.g. "0,3,4"
+         * @param width The number of columns
+         * @return Whether each column is in the list. Caller must free.
+         */
+        bool* parse_cols_arg(char* arg, size_t width) {
+            bool* wanted = new bool[width];
+            for (size_t i = 0; i < width; i++) {
+                wanted[i] = false;
+            }
+            char* pos = arg;
+            while (*pos != '\0') {
+                char* end;
+                long col = strtol(pos, &end, 10);
+                if (end == pos || col < 0 || (size_t)col >= width) {
+                    printf("No such column\n");
+                    exit(-1);
+                }
+                wanted[col] = true;
+                pos = *end == ',' ? end + 1 : end;
+                cli_assert(*end == ',' || *end == '\0');
+            }
+            return wanted;
+        }
+
         /**
          * Parses command line args given by argc and argv. Updates the given ssize_t pointers to
          * -1 for each arg that is not present on the command line (nullptr for file), or the value of that
@@ -149,11 +288,21 @@ class ParserMain {
          * @param col_type Pointer to result of parsing -print_col_type
          * @param col_idx_col, col_idx_off Pointer to result of parsing -print_col_idx
          * @param missing_idx_col, missing_idx_off Pointer to result of parsing -is_missing_idx
+         * @param parse_threads Pointer to result of parsing -parse_threads
+         * @param load_bin Pointer to result of parsing -load_bin
+         * @param save_bin Pointer to result of parsing -save_bin
+         * @param cols Pointer to result of parsing -cols
+         * @param stream Pointer to result of parsing -stream
          */
         void parse_args(int argc, char* argv[], char** file, ssize_t* start, ssize_t* len,
                         ssize_t* col_type, ssize_t* col_idx_col, ssize_t* col_idx_off,
-                        ssize_t* missing_idx_col, ssize_t* missing_idx_off) {
+                        ssize_t* missing_idx_col, ssize_t* missing_idx_off,
+                        ssize_t* parse_threads, char** load_bin, char** save_bin,
+                        char** cols, ssize_t* stream) {
             *file = nullptr;
+            *cols = nullptr;
+            *load_bin = nullptr;
+            *save_bin = nullptr;
             // -1 represents argument not provided
             *start = -1;
             *len = -1;
@@ -162,6 +311,8 @@ class ParserMain {
             *col_idx_off = -1;
             *missing_idx_col = -1;
             *missing_idx_off = -1;
+            *parse_threads = -1;
+            *stream = -1;
 
             ParseState state = ParseState::DEFAULT;
 
@@ -181,6 +332,16 @@ class ParserMain {
                             state = ParseState::FLAG_COL_IDX_COL;
                         } else if (strcmp(arg, "-is_missing_idx") == 0) {
                             state = ParseState::FLAG_MISSING_IDX_COL;
+                        } else if (strcmp(arg, "-parse_threads") == 0) {
+                            state = ParseState::FLAG_PARSE_THREADS;
+                        } else if (strcmp(arg, "-load_bin") == 0) {
+                            state = ParseState::FLAG_LOAD_BIN;
+                        } else if (strcmp(arg, "-save_bin") == 0) {
+                            state = ParseState::FLAG_SAVE_BIN;
+                        } else if (strcmp(arg, "-cols") == 0) {
+                            state = ParseState::FLAG_COLS;
+                        } else if (strcmp(arg, "-stream") == 0) {
+                            state = ParseState::FLAG_STREAM;
                         } else {
                             // cli_assert(false);
                         }
@@ -218,6 +379,29 @@ class ParserMain {
                         parse_size_t_arg(missing_idx_off, arg);
                         state = ParseState::DEFAULT;
                         break;
+                    case ParseState::FLAG_PARSE_THREADS:
+                        parse_size_t_arg(parse_threads, arg);
+                        state = ParseState::DEFAULT;
+                        break;
+                    case ParseState::FLAG_LOAD_BIN:
+                        cli_assert(*load_bin == nullptr);
+                        *load_bin = arg;
+                        state = ParseState::DEFAULT;
+                        break;
+                    case ParseState::FLAG_SAVE_BIN:
+                        cli_assert(*save_bin == nullptr);
+                        *save_bin = arg;
+                        state = ParseState::DEFAULT;
+                        break;
+                    case ParseState::FLAG_COLS:
+                        cli_assert(*cols == nullptr);
+                        *cols = arg;
+                        state = ParseState::DEFAULT;
+                        break;
+                    case ParseState::FLAG_STREAM:
+                        parse_size_t_arg(stream, arg);
+                        state = ParseState::DEFAULT;
+                        break;
                     default:
                         cli_assert(false);
                 }
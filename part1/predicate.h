@@ -0,0 +1,587 @@
+//lang::CwC
+
+#pragma once
+
+#include "column.h"
+#include "schema.h"
+#include "thread.h"
+
+// Comparison operators of a ComparePredicate
+#define CMP_EQ 0
+#define CMP_NE 1
+#define CMP_LT 2
+#define CMP_LE 3
+#define CMP_GT 4
+#define CMP_GE 5
+
+/*************************************************************************
+ * Predicate::
+ * A condition on the rows of a dataframe, built from comparisons, ranges and
+ * missing value checks on typed columns combined with and, or and not, that
+ * DataFrame::filter and filter_view can select rows with instead of a
+ * Rower. A predicate is evaluated a run of rows at a time into a bitmap, in
+ * tight loops over the column storage, with no call per row. Predicates own
+ * the predicates they combine.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class Predicate : public Object {
+    public:
+        /** Subclass responsibility, terminates unless every column the
+         *  predicate reads exists in the given schema and has the right
+         *  type. */
+        virtual void check(Schema& schema) = 0;
+
+        /** Subclass responsibility, sets bit i of words to whether row
+         *  start + i passes, for the len rows from start, which lie in a
+         *  single storage chunk. The rows are read from cols, the columns of
+         *  the frame, through rows, the rows of a view, unless it is nullptr.
+         *  Bits past len in the last word are cleared. */
+        virtual void eval(Column** cols, SizeArray* rows, size_t start, size_t len,
+                          uint64_t* words) = 0;
+
+        /** Subclass responsibility, clears bit i of words when row start + i
+         *  is missing in a column whose values the predicate compares, for
+         *  the rows given as in eval. */
+        virtual void mask_operands(Column** cols, SizeArray* rows, size_t start, size_t len,
+                                   uint64_t* words) = 0;
+
+        /** Returns the number of words holding len bits. */
+        static size_t word_count(size_t len) {
+            return (len + 63) / 64;
+        }
+
+        /** Sets bit i of words to test(i) for every i below len. Each full
+         *  word is built by a loop of exactly 64 tests, which the compiler
+         *  unrolls and vectorizes. */
+        template <class F>
+        static void pack(size_t len, uint64_t* words, F test) {
+            size_t full = len / 64;
+            for (size_t w = 0; w < full; w++) {
+                uint64_t word = 0;
+                for (size_t b = 0; b < 64; b++) {
+                    word |= (uint64_t)test(w * 64 + b) << b;
+                }
+                words[w] = word;
+            }
+            if (len % 64 != 0) {
+                uint64_t word = 0;
+                for (size_t b = 0; b < len % 64; b++) {
+                    word |= (uint64_t)test(full * 64 + b) << b;
+                }
+                words[full] = word;
+            }
+        }
+
+        /** Returns the len values of vals, a chunked array, from row start,
+         *  which lie in a single storage chunk. They are read in place, or
+         *  through rows into buf if rows is not nullptr. */
+        template <class A, class T>
+        static const T* values(A* vals, SizeArray* rows, size_t start, size_t len, T* buf) {
+            if (rows == nullptr) {
+                return vals->chunk(start >> ARRAY_CHUNK_SHIFT) + (start & ARRAY_CHUNK_MASK);
+            }
+            for (size_t i = 0; i < len; i++) {
+                buf[i] = vals->get(rows->get(start + i));
+            }
+            return buf;
+        }
+
+        /** Returns the row of the frame's columns that row i reads. */
+        static size_t row(SizeArray* rows, size_t i) {
+            return rows == nullptr ? i : rows->get(i);
+        }
+
+        /** Sets the bits of words to the outcome of comparing each of the len
+         *  values with value using op. */
+        template <class T>
+        static void compare(const T* vals, size_t len, int op, T value, uint64_t* words) {
+            switch (op) {
+                case CMP_EQ:
+                    pack(len, words, [=](size_t i) { return vals[i] == value; });
+                    break;
+                case CMP_NE:
+                    pack(len, words, [=](size_t i) { return vals[i] != value; });
+                    break;
+                case CMP_LT:
+                    pack(len, words, [=](size_t i) { return vals[i] < value; });
+                    break;
+                case CMP_LE:
+                    pack(len, words, [=](size_t i) { return vals[i] <= value; });
+                    break;
+                case CMP_GT:
+                    pack(len, words, [=](size_t i) { return vals[i] > value; });
+                    break;
+                case CMP_GE:
+                    pack(len, words, [=](size_t i) { return vals[i] >= value; });
+                    break;
+            }
+        }
+
+        /** Clears the bits of words of the rows whose value in col is missing,
+         *  for the len rows from start as in eval. The column's bitmap is
+         *  combined a word at a time, and a column with no missing values is
+         *  left alone. A string column is checked a row at a time. */
+        static void mask_missing(Column* col, SizeArray* rows, size_t start, size_t len,
+                                 uint64_t* words) {
+            if (col->get_type() == 'S') {
+                for (size_t i = 0; i < len; i++) {
+                    if (col->is_missing(row(rows, start + i))) words[i / 64] &= ~((uint64_t)1 << (i % 64));
+                }
+                return;
+            }
+            if (col->get_validity() == nullptr) return;
+            if (rows == nullptr) {
+                const uint64_t* valid = col->chunk_validity(start >> ARRAY_CHUNK_SHIFT) +
+                                        (start & ARRAY_CHUNK_MASK) / 64;
+                for (size_t w = 0; w < word_count(len); w++) {
+                    words[w] &= valid[w];
+                }
+                return;
+            }
+            for (size_t i = 0; i < len; i++) {
+                if (col->is_missing(rows->get(start + i))) words[i / 64] &= ~((uint64_t)1 << (i % 64));
+            }
+        }
+
+        /** Returns whether a comparison with op holds for the given sign of
+         *  a three-way comparison. */
+        static bool holds(int op, int cmp) {
+            switch (op) {
+                case CMP_EQ: return cmp == 0;
+                case CMP_NE: return cmp != 0;
+                case CMP_LT: return cmp < 0;
+                case CMP_LE: return cmp <= 0;
+                case CMP_GT: return cmp > 0;
+                default: return cmp >= 0;
+            }
+        }
+};
+
+/**
+ * Compares every value of a column with a constant of its type: an int,
+ * float, bool (false before true) or string (byte by byte, a prefix before
+ * the longer string). A missing value passes no comparison. Equality tests
+ * on a dictionary encoded column compare codes.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class ComparePredicate : public Predicate {
+    public:
+        size_t col_;
+        int op_;
+        // The type of the column and the constant under that type
+        char type_;
+        int int_;
+        float float_;
+        bool bool_;
+        String* string_;
+
+        ComparePredicate(size_t col, int op, int value) {
+            init_(col, op, 'I');
+            int_ = value;
+        }
+
+        ComparePredicate(size_t col, int op, float value) {
+            init_(col, op, 'F');
+            float_ = value;
+        }
+
+        /** Compares with a float column, so that a double literal such as
+         *  1.5 can be given. */
+        ComparePredicate(size_t col, int op, double value)
+            : ComparePredicate(col, op, (float)value) {}
+
+        ComparePredicate(size_t col, int op, bool value) {
+            init_(col, op, 'B');
+            bool_ = value;
+        }
+
+        /** The characters of value are copied. */
+        ComparePredicate(size_t col, int op, const char* value) {
+            init_(col, op, 'S');
+            string_ = new String(value);
+        }
+
+        ~ComparePredicate() {
+            delete string_;
+        }
+
+        void init_(size_t col, int op, char type) {
+            exit_if_not(op >= CMP_EQ && op <= CMP_GE, "Invalid comparison operator.");
+            col_ = col;
+            op_ = op;
+            type_ = type;
+            string_ = nullptr;
+        }
+
+        void check(Schema& schema) {
+            exit_if_not(col_ < schema.width(), "Predicate column index out of bounds.");
+            exit_if_not(schema.col_type(col_) == type_, "Predicate compares a column of another type.");
+        }
+
+        void eval(Column** cols, SizeArray* rows, size_t start, size_t len, uint64_t* words) {
+            Column* col = cols[col_];
+            switch (type_) {
+                case 'I': {
+                    int* buf = rows == nullptr ? nullptr : new int[len];
+                    compare(values(col->as_int()->get_fields(), rows, start, len, buf), len, op_, int_, words);
+                    delete[] buf;
+                    break;
+                }
+                case 'F': {
+                    float* buf = rows == nullptr ? nullptr : new float[len];
+                    compare(values(col->as_float()->get_fields(), rows, start, len, buf), len, op_, float_, words);
+                    delete[] buf;
+                    break;
+                }
+                case 'B': {
+                    BoolArray* vals = col->as_bool()->get_fields();
+                    int value = bool_;
+                    int op = op_;
+                    pack(len, words, [=](size_t i) {
+                        return holds(op, (int)vals->get(row(rows, start + i)) - value);
+                    });
+                    break;
+                }
+                case 'S':
+                    eval_strings_(col->as_string(), rows, start, len, words);
+                    return;
+            }
+            mask_missing(col, rows, start, len, words);
+        }
+
+        void mask_operands(Column** cols, SizeArray* rows, size_t start, size_t len,
+                           uint64_t* words) {
+            mask_missing(cols[col_], rows, start, len, words);
+        }
+
+        /** Private function that compares the strings of col. */
+        void eval_strings_(StringColumn* col, SizeArray* rows, size_t start, size_t len,
+                           uint64_t* words) {
+            if (col->is_dictionary() && (op_ == CMP_EQ || op_ == CMP_NE)) {
+                size_t code;
+                int value = col->dict_->get(string_, &code) ? (int)code : -2;
+                int* buf = rows == nullptr ? nullptr : new int[len];
+                const int* codes = values(col->codes_, rows, start, len, buf);
+                if (op_ == CMP_EQ) {
+                    pack(len, words, [=](size_t i) { return codes[i] == value; });
+                } else {
+                    pack(len, words, [=](size_t i) { return codes[i] >= 0 && codes[i] != value; });
+                }
+                delete[] buf;
+                return;
+            }
+            const char* chars = string_->c_str();
+            size_t size = string_->size();
+            int op = op_;
+            pack(len, words, [=](size_t i) {
+                size_t r = row(rows, start + i);
+                int sa = col->get_size(r);
+                if (sa < 0) return false;
+                size_t n = (size_t)sa < size ? sa : size;
+                int cmp = memcmp(col->get_chars(r), chars, n);
+                if (cmp == 0) cmp = (size_t)sa < size ? -1 : (size_t)sa > size ? 1 : 0;
+                return holds(op, cmp);
+            });
+        }
+};
+
+/**
+ * Checks that every value of an int or float column lies between two
+ * constants, inclusive. A missing value does not.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class BetweenPredicate : public Predicate {
+    public:
+        size_t col_;
+        char type_;
+        int int_lo_;
+        int int_hi_;
+        float float_lo_;
+        float float_hi_;
+
+        BetweenPredicate(size_t col, int lo, int hi) {
+            col_ = col;
+            type_ = 'I';
+            int_lo_ = lo;
+            int_hi_ = hi;
+        }
+
+        BetweenPredicate(size_t col, float lo, float hi) {
+            col_ = col;
+            type_ = 'F';
+            float_lo_ = lo;
+            float_hi_ = hi;
+        }
+
+        /** Tests a float column, so that double literals can be given. */
+        BetweenPredicate(size_t col, double lo, double hi)
+            : BetweenPredicate(col, (float)lo, (float)hi) {}
+
+        void check(Schema& schema) {
+            exit_if_not(col_ < schema.width(), "Predicate column index out of bounds.");
+            exit_if_not(schema.col_type(col_) == type_, "Predicate compares a column of another type.");
+        }
+
+        /** Private function that tests the len values of vals. */
+        template <class T>
+        static void between_(const T* vals, size_t len, T lo, T hi, uint64_t* words) {
+            pack(len, words, [=](size_t i) { return lo <= vals[i] && vals[i] <= hi; });
+        }
+
+        void eval(Column** cols, SizeArray* rows, size_t start, size_t len, uint64_t* words) {
+            Column* col = cols[col_];
+            if (type_ == 'I') {
+                int* buf = rows == nullptr ? nullptr : new int[len];
+                between_(values(col->as_int()->get_fields(), rows, start, len, buf), len, int_lo_,
+                         int_hi_, words);
+                delete[] buf;
+            } else {
+                float* buf = rows == nullptr ? nullptr : new float[len];
+                between_(values(col->as_float()->get_fields(), rows, start, len, buf), len,
+                         float_lo_, float_hi_, words);
+                delete[] buf;
+            }
+            mask_missing(col, rows, start, len, words);
+        }
+
+        void mask_operands(Column** cols, SizeArray* rows, size_t start, size_t len,
+                           uint64_t* words) {
+            mask_missing(cols[col_], rows, start, len, words);
+        }
+};
+
+/**
+ * Checks whether each value of a column is missing, a word of the column's
+ * bitmap at a time for an int, bool or float column.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class MissingPredicate : public Predicate {
+    public:
+        size_t col_;
+
+        MissingPredicate(size_t col) {
+            col_ = col;
+        }
+
+        void check(Schema& schema) {
+            exit_if_not(col_ < schema.width(), "Predicate column index out of bounds.");
+        }
+
+        void eval(Column** cols, SizeArray* rows, size_t start, size_t len, uint64_t* words) {
+            Column* col = cols[col_];
+            if (col->get_type() == 'S') {
+                StringColumn* strings = col->as_string();
+                pack(len, words, [=](size_t i) { return strings->get_size(row(rows, start + i)) < 0; });
+                return;
+            }
+            if (col->get_validity() == nullptr) {
+                for (size_t w = 0; w < word_count(len); w++) {
+                    words[w] = 0;
+                }
+                return;
+            }
+            if (rows != nullptr) {
+                pack(len, words, [=](size_t i) { return col->is_missing(rows->get(start + i)); });
+                return;
+            }
+            const uint64_t* valid = col->chunk_validity(start >> ARRAY_CHUNK_SHIFT) +
+                                    (start & ARRAY_CHUNK_MASK) / 64;
+            for (size_t w = 0; w < word_count(len); w++) {
+                words[w] = ~valid[w];
+            }
+            if (len % 64 != 0) words[word_count(len) - 1] &= ((uint64_t)1 << (len % 64)) - 1;
+        }
+
+        /** Whether a value is missing is known for every row, so nothing is
+         *  cleared. */
+        void mask_operands(Column**, SizeArray*, size_t, size_t, uint64_t*) {}
+};
+
+/**
+ * Passes the rows that pass both of two predicates. The second one is not
+ * evaluated on runs of rows that all fail the first one.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class AndPredicate : public Predicate {
+    public:
+        Predicate* left_;
+        Predicate* right_;
+
+        AndPredicate(Predicate* left, Predicate* right) {
+            left_ = left;
+            right_ = right;
+        }
+
+        ~AndPredicate() {
+            delete left_;
+            delete right_;
+        }
+
+        void check(Schema& schema) {
+            left_->check(schema);
+            right_->check(schema);
+        }
+
+        void eval(Column** cols, SizeArray* rows, size_t start, size_t len, uint64_t* words) {
+            size_t nwords = word_count(len);
+            left_->eval(cols, rows, start, len, words);
+            uint64_t any = 0;
+            for (size_t w = 0; w < nwords; w++) {
+                any |= words[w];
+            }
+            if (any == 0) return;
+            uint64_t* other = new uint64_t[nwords];
+            right_->eval(cols, rows, start, len, other);
+            for (size_t w = 0; w < nwords; w++) {
+                words[w] &= other[w];
+            }
+            delete[] other;
+        }
+
+        void mask_operands(Column** cols, SizeArray* rows, size_t start, size_t len,
+                           uint64_t* words) {
+            left_->mask_operands(cols, rows, start, len, words);
+            right_->mask_operands(cols, rows, start, len, words);
+        }
+};
+
+/**
+ * Passes the rows that pass either of two predicates.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class OrPredicate : public Predicate {
+    public:
+        Predicate* left_;
+        Predicate* right_;
+
+        OrPredicate(Predicate* left, Predicate* right) {
+            left_ = left;
+            right_ = right;
+        }
+
+        ~OrPredicate() {
+            delete left_;
+            delete right_;
+        }
+
+        void check(Schema& schema) {
+            left_->check(schema);
+            right_->check(schema);
+        }
+
+        void eval(Column** cols, SizeArray* rows, size_t start, size_t len, uint64_t* words) {
+            size_t nwords = word_count(len);
+            left_->eval(cols, rows, start, len, words);
+            uint64_t* other = new uint64_t[nwords];
+            right_->eval(cols, rows, start, len, other);
+            for (size_t w = 0; w < nwords; w++) {
+                words[w] |= other[w];
+            }
+            delete[] other;
+        }
+
+        void mask_operands(Column** cols, SizeArray* rows, size_t start, size_t len,
+                           uint64_t* words) {
+            left_->mask_operands(cols, rows, start, len, words);
+            right_->mask_operands(cols, rows, start, len, words);
+        }
+};
+
+/**
+ * Passes the rows that fail a predicate, leaving out the rows missing a
+ * value that it compares, so that those pass neither a predicate nor its
+ * negation.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class NotPredicate : public Predicate {
+    public:
+        Predicate* pred_;
+
+        NotPredicate(Predicate* pred) {
+            pred_ = pred;
+        }
+
+        ~NotPredicate() {
+            delete pred_;
+        }
+
+        void check(Schema& schema) {
+            pred_->check(schema);
+        }
+
+        void eval(Column** cols, SizeArray* rows, size_t start, size_t len, uint64_t* words) {
+            size_t nwords = word_count(len);
+            pred_->eval(cols, rows, start, len, words);
+            for (size_t w = 0; w < nwords; w++) {
+                words[w] = ~words[w];
+            }
+            if (len % 64 != 0) words[nwords - 1] &= ((uint64_t)1 << (len % 64)) - 1;
+            pred_->mask_operands(cols, rows, start, len, words);
+        }
+
+        void mask_operands(Column** cols, SizeArray* rows, size_t start, size_t len,
+                           uint64_t* words) {
+            pred_->mask_operands(cols, rows, start, len, words);
+        }
+};
+
+/**
+ * Task that evaluates a predicate on every row of a dataframe into a
+ * selection bitmap, one storage chunk of rows per unit of work, and counts
+ * the selected rows of each chunk.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class PredicateTask : public ChunkTask {
+    public:
+        // The predicate, the frame's columns and the rows of a view or
+        // nullptr, external
+        Predicate* pred_;
+        Column** cols_;
+        SizeArray* rows_;
+        size_t length_;
+        // The selection bitmap, already sized to the number of rows, and the
+        // number of selected rows in each chunk, external
+        BoolArray* sel_;
+        size_t* counts_;
+
+        PredicateTask(Predicate* pred, Column** cols, SizeArray* rows, size_t length, BoolArray* sel,
+                      size_t* counts, size_t nchunks, size_t nworkers)
+            : ChunkTask(nchunks, nworkers) {
+            pred_ = pred;
+            cols_ = cols;
+            rows_ = rows;
+            length_ = length;
+            sel_ = sel;
+            counts_ = counts;
+        }
+
+        void run_chunk(size_t k) {
+            size_t start = k * ARRAY_CHUNK_SIZE;
+            size_t len = length_ - start < ARRAY_CHUNK_SIZE ? length_ - start : ARRAY_CHUNK_SIZE;
+            // A chunk's words lie in a single chunk of the bitmap
+            size_t first = start / 64;
+            uint64_t* words = sel_->chunk(first >> ARRAY_CHUNK_SHIFT) + (first & ARRAY_CHUNK_MASK);
+            pred_->eval(cols_, rows_, start, len, words);
+            size_t count = 0;
+            for (size_t w = 0; w < Predicate::word_count(len); w++) {
+                count += __builtin_popcountll(words[w]);
+            }
+            counts_[k] = count;
+        }
+};
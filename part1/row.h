@@ -5,8 +5,14 @@
 #include "object.h"
 #include "array.h"
 #include "schema.h"
+#include "column.h"
 #include "visitors.h"
 
+// Number of rows in each RowBlock. It divides ARRAY_CHUNK_SIZE, so a block
+// never straddles two chunks of column storage, and is a multiple of 64, so
+// the booleans of a block start at a word boundary.
+#define BLOCK_ROWS 4096
+
 /*************************************************************************
  * Row::
  *
@@ -23,6 +29,9 @@ class Row : public Object {
         IntArray* col_types_;
         Array* fields_;
         size_t idx_;
+        // One view per column for the strings set by set_view, created on
+        // first use
+        ArenaString* views_;
  
         /** Build a row following a schema. */
         Row(Schema& scm) {
@@ -30,6 +39,7 @@ class Row : public Object {
             col_types_->append_all(scm.get_types());
             fields_ = new Array();
             idx_ = -1;
+            views_ = nullptr;
 
             for (int i = 0; i < col_types_->size(); i++) {
                 char type = col_types_->get(i);
@@ -56,6 +66,7 @@ class Row : public Object {
         ~Row() {
             delete col_types_;
             delete fields_;
+            delete[] views_;
         }
         
         /** Setters: set the given column with the given value. Setting a column with
@@ -93,6 +104,14 @@ class Row : public Object {
             }
             arr->set(val, 0);
         }
+
+        /** Sets the given string column to the string at idx of the given
+         *  column without copying it. The value is only valid until that
+         *  field of the column changes. */
+        void set_view(size_t col, StringColumn* column, size_t idx) {
+            if (views_ == nullptr) views_ = new ArenaString[width()];
+            set(col, column->get(idx, &views_[col]));
+        }
         
         /** Set/get the index of this row (ie. its position in the dataframe. This is
          *  only used for informational purposes, unused otherwise */
@@ -180,4 +199,330 @@ class Row : public Object {
         IntArray* get_types() {
             return col_types_;
         }
-};
\ No newline at end of file
+};
+
+/*************************************************************************
+ * RowView::
+ *
+ * A row of a dataframe read in place: the view only knows the dataframe's
+ * columns and a row index, and every getter reads straight from the column.
+ * For a dataframe that is itself a view of another one, the row read from
+ * the columns differs from the row's index in the view, which is the one
+ * that get_idx reports.
+ * Moving the view to another row is just set_idx(), nothing is copied or
+ * allocated. Getting a value of the wrong type is an error, as with Row.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class RowView : public Object {
+    public:
+        // The dataframe's columns and schema, external
+        Array* columns_;
+        Schema* schema_;
+        // The row of the columns that the getters read
+        size_t idx_;
+        // The index of the row in its dataframe, plus base_, is reported by
+        // get_idx
+        size_t pos_;
+        size_t base_;
+        // Copy of the current row handed to Rowers that only accept a Row,
+        // created on first use
+        Row* row_;
+        // One view per column for the strings of the current row, nstrings_
+        // of them, created on first use
+        ArenaString* strings_;
+        size_t nstrings_;
+
+        /** Build a view over the given columns, which follow the schema. */
+        RowView(Array* columns, Schema* schema) {
+            columns_ = columns;
+            schema_ = schema;
+            idx_ = 0;
+            pos_ = 0;
+            base_ = 0;
+            row_ = nullptr;
+            strings_ = nullptr;
+            nstrings_ = 0;
+        }
+
+        /** Destructor */
+        ~RowView() {
+            delete row_;
+            delete[] strings_;
+        }
+
+        /** Returns the column at the given index, loading it first if it is
+         *  loaded lazily. */
+        Column* column_(size_t col) {
+            Column* column = static_cast<Column*>(columns_->get(col));
+            column->materialize();
+            return column;
+        }
+
+        /** Returns the column at the given index, checking its type. */
+        Column* column_(size_t col, char type) {
+            exit_if_not(col < width(), "Column index out of bounds.");
+            Column* column = column_(col);
+            exit_if_not(column->get_type() == type, "Column index corresponds to the wrong type.");
+            return column;
+        }
+
+        /** Getters: get the value at the given column of the current row. */
+        int get_int(size_t col) {
+            return static_cast<IntColumn*>(column_(col, 'I'))->get(idx_);
+        }
+        bool get_bool(size_t col) {
+            return static_cast<BoolColumn*>(column_(col, 'B'))->get(idx_);
+        }
+        float get_float(size_t col) {
+            return static_cast<FloatColumn*>(column_(col, 'F'))->get(idx_);
+        }
+        /** The String belongs to this view and is only valid until the view
+         *  moves to another row. */
+        String* get_string(size_t col) {
+            return string_(static_cast<StringColumn*>(column_(col, 'S')), col);
+        }
+
+        /** Returns the string of the given column at the current row, read
+         *  through this view's own view of that column. */
+        String* string_(StringColumn* column, size_t col) {
+            if (col >= nstrings_) {
+                delete[] strings_;
+                nstrings_ = width();
+                strings_ = new ArenaString[nstrings_];
+            }
+            return column->get(idx_, &strings_[col]);
+        }
+
+        /** Returns whether the field at the given column of the current row
+         *  is missing. */
+        bool is_missing(size_t col) {
+            exit_if_not(col < width(), "Column index out of bounds.");
+            return column_(col)->is_missing(idx_);
+        }
+
+        /** Set/get the index of the row this view reads. get_idx adds the
+         *  base to it (see set_base). */
+        void set_idx(size_t idx) {
+            set_idx(idx, idx);
+        }
+        size_t get_idx() {
+            return base_ + pos_;
+        }
+
+        /** Moves the view to the row at index idx of a dataframe that is a
+         *  view, which reads row read of the columns. */
+        void set_idx(size_t idx, size_t read) {
+            pos_ = idx;
+            idx_ = read;
+        }
+
+        /** Sets the amount added to the index of every row this view reads
+         *  before it is reported, e.g. the index of the first row of a
+         *  chunk within the whole file. */
+        void set_base(size_t base) {
+            base_ = base;
+        }
+
+        /** Number of fields in the row. */
+        size_t width() {
+            return schema_->width();
+        }
+
+        /** Type of the field at the given position. */
+        char col_type(size_t idx) {
+            return schema_->col_type(idx);
+        }
+
+        /** Given a Fielder, visit every field of the current row. */
+        void visit(size_t idx, Fielder& f) {
+            f.start(idx);
+            for (size_t i = 0; i < width(); i++) {
+                Column* column = column_(i);
+                switch (column->get_type()) {
+                    case 'I':
+                        f.accept(static_cast<IntColumn*>(column)->get(idx_));
+                        break;
+                    case 'B':
+                        f.accept(static_cast<BoolColumn*>(column)->get(idx_));
+                        break;
+                    case 'F':
+                        f.accept(static_cast<FloatColumn*>(column)->get(idx_));
+                        break;
+                    case 'S':
+                        f.accept(string_(static_cast<StringColumn*>(column), i));
+                        break;
+                    default:
+                        exit_if_not(false, "Invalid type found.");
+                }
+            }
+            f.done();
+        }
+
+        /** Copies the current row into a Row owned by this view and returns it. */
+        Row& as_row() {
+            if (row_ == nullptr) row_ = new Row(*schema_);
+            row_->set_idx(get_idx());
+            for (size_t i = 0; i < width(); i++) {
+                Column* column = column_(i);
+                switch (column->get_type()) {
+                    case 'I':
+                        row_->set(i, static_cast<IntColumn*>(column)->get(idx_));
+                        break;
+                    case 'B':
+                        row_->set(i, static_cast<BoolColumn*>(column)->get(idx_));
+                        break;
+                    case 'F':
+                        row_->set(i, static_cast<FloatColumn*>(column)->get(idx_));
+                        break;
+                    case 'S':
+                        row_->set_view(i, static_cast<StringColumn*>(column), idx_);
+                        break;
+                    default:
+                        exit_if_not(false, "Invalid type found.");
+                }
+            }
+            return *row_;
+        }
+};
+
+/** Rowers that only know about Rows get a copy of the viewed row. */
+inline bool Rower::accept(RowView& r) {
+    return accept(r.as_row());
+}
+
+/*************************************************************************
+ * RowBlock::
+ *
+ * A run of consecutive rows [start, end) of a dataframe, handed to Rowers so
+ * they can work a column at a time. Within a block every int and float
+ * column is a contiguous array, and every bool column is a contiguous run of
+ * 64-bit words. A block never spans more than BLOCK_ROWS rows. The pointers
+ * are into the dataframe's storage and are only valid during the call.
+ * 
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class RowBlock : public Object {
+    public:
+        // The dataframe's columns and schema, external
+        Array* columns_;
+        Schema* schema_;
+        size_t start_;
+        size_t end_;
+        // Added to start_ and end_ to get the indices reported by start()
+        // and end()
+        size_t base_;
+        // View used to visit the block one row at a time
+        RowView* view_;
+
+        /** Build an empty block over the given columns, which follow the schema. */
+        RowBlock(Array* columns, Schema* schema) {
+            columns_ = columns;
+            schema_ = schema;
+            start_ = 0;
+            end_ = 0;
+            base_ = 0;
+            view_ = new RowView(columns, schema);
+        }
+
+        /** Destructor */
+        ~RowBlock() {
+            delete view_;
+        }
+
+        /** Moves the block to rows [start, end), which must lie within one
+         *  aligned run of BLOCK_ROWS rows. */
+        void set_range(size_t start, size_t end) {
+            assert(start <= end && end - start <= BLOCK_ROWS);
+            assert(end == start || start / BLOCK_ROWS == (end - 1) / BLOCK_ROWS);
+            start_ = start;
+            end_ = end;
+        }
+
+        /** Sets the amount added to the indices of the block's rows before
+         *  they are reported (see RowView::set_base). */
+        void set_base(size_t base) {
+            base_ = base;
+            view_->set_base(base);
+        }
+
+        /** The index of the first row in the block and one past the last,
+         *  with the base added. */
+        size_t start() {
+            return base_ + start_;
+        }
+        size_t end() {
+            return base_ + end_;
+        }
+
+        /** The number of rows in the block. */
+        size_t length() {
+            return end_ - start_;
+        }
+
+        /** Number of columns. */
+        size_t width() {
+            return schema_->width();
+        }
+
+        /** Type of the column at the given position. */
+        char col_type(size_t col) {
+            return schema_->col_type(col);
+        }
+
+        /** Returns the column at the given index, checking its type. */
+        Column* column_(size_t col, char type) {
+            return view_->column_(col, type);
+        }
+
+        /** Returns the values of an int column for this block; element i is
+         *  row start() + i. */
+        const int* ints(size_t col) {
+            IntArray* arr = static_cast<IntColumn*>(column_(col, 'I'))->get_fields();
+            return arr->chunk(start_ >> ARRAY_CHUNK_SHIFT) + (start_ & ARRAY_CHUNK_MASK);
+        }
+
+        /** Returns the values of a float column for this block; element i is
+         *  row start() + i. */
+        const float* floats(size_t col) {
+            FloatArray* arr = static_cast<FloatColumn*>(column_(col, 'F'))->get_fields();
+            return arr->chunk(start_ >> ARRAY_CHUNK_SHIFT) + (start_ & ARRAY_CHUNK_MASK);
+        }
+
+        /** Position of the block's first row within its word, 0 unless the
+         *  block starts at a row that is not a multiple of 64. */
+        size_t bit_offset() {
+            return start_ % 64;
+        }
+
+        /** Returns the words of a bool column for this block: with
+         *  j = bit_offset() + i, bit j % 64 of word j / 64 is row start() + i. */
+        const uint64_t* bools(size_t col) {
+            BoolArray* arr = static_cast<BoolColumn*>(column_(col, 'B'))->get_fields();
+            size_t w = start_ / 64;
+            return arr->chunk(w >> ARRAY_CHUNK_SHIFT) + (w & ARRAY_CHUNK_MASK);
+        }
+
+        /** Returns the string column's values for row start() + i. The
+         *  String belongs to the block and is only valid until the next call
+         *  to get_string or row(). */
+        String* get_string(size_t col, size_t i) {
+            return row(i).get_string(col);
+        }
+
+        /** Returns a view positioned on row start() + i. */
+        RowView& row(size_t i) {
+            assert(i < length());
+            view_->set_idx(start_ + i);
+            return *view_;
+        }
+};
+
+/** Rowers that do not work on blocks see each row of the block in order. */
+inline void Rower::accept(RowBlock& b) {
+    for (size_t i = 0; i < b.length(); i++) {
+        accept(b.row(i));
+    }
+}
@@ -4,6 +4,7 @@
 
 #include "object.h"
 #include "array.h"
+#include "string_map.h"
 
 /*************************************************************************
  * Schema::
@@ -11,6 +12,7 @@
  * knows the number of columns and number of rows, the type of each column,
  * optionally columns and rows can be named by strings.
  * The valid types are represented by the chars 'S', 'B', 'I' and 'F'.
+ * Names are indexed by hash, so looking up a name takes constant time.
  * 
  * @author Spencer LaChance <lachance.s@husky.neu.edu>
  * @author David Mberingabo <mberingabo.d@husky.neu.edu>
@@ -20,6 +22,9 @@ class Schema : public Object {
         IntArray* col_types_;
         Array* col_names_;
         Array* row_names_;
+        // Index of each column and row name
+        StringMap* col_index_;
+        StringMap* row_index_;
  
         /** Copying constructor */
         Schema(Schema& from) {
@@ -29,6 +34,8 @@ class Schema : public Object {
             col_types_->append_all(from.get_types());
             col_names_->append_all(from.get_col_names());
             row_names_->append_all(from.get_row_names());
+            col_index_ = index_names_(col_names_);
+            row_index_ = index_names_(row_names_);
         }
         
         /** Create an empty schema **/
@@ -36,6 +43,8 @@ class Schema : public Object {
             col_types_ = new IntArray();
             col_names_ = new Array();
             row_names_ = new Array();
+            col_index_ = new StringMap();
+            row_index_ = new StringMap();
         }
         
         /** Create a schema from a string of types. A string that contains
@@ -47,6 +56,8 @@ class Schema : public Object {
             col_types_ = new IntArray();
             col_names_ = new Array();
             row_names_ = new Array();
+            col_index_ = new StringMap();
+            row_index_ = new StringMap();
             for (int i = 0; i < strlen(types); i++) {
                 char c = types[i];
                 exit_if_not(c == 'S' || c == 'B' || c == 'I' || c == 'F', 
@@ -61,6 +72,25 @@ class Schema : public Object {
             delete col_types_;
             delete col_names_;
             delete row_names_;
+            delete col_index_;
+            delete row_index_;
+        }
+
+        /** Private function that builds an index of the given names. */
+        static StringMap* index_names_(Array* names) {
+            StringMap* index = new StringMap();
+            for (size_t i = 0; i < names->size(); i++) {
+                String* name = static_cast<String*>(names->get(i));
+                if (name != nullptr) index->put(name, i);
+            }
+            return index;
+        }
+
+        /** Private function that looks the given name up in the given index
+         *  and returns its index, or -1. */
+        static int find_name_(StringMap* index, const char* name) {
+            size_t idx;
+            return index->get(name, strlen(name), &idx) ? idx : -1;
         }
         
         /** Add a column of the given type and name (can be nullptr), name
@@ -69,7 +99,9 @@ class Schema : public Object {
         void add_column(char typ, String* name) {
             col_types_->append(typ);
             if (name != nullptr) {
-                exit_if_not(!col_names_->contains(name), "Duplicate column name given.");
+                size_t idx;
+                exit_if_not(!col_index_->get(name, &idx), "Duplicate column name given.");
+                col_index_->put(name, col_names_->size());
             }
             col_names_->append(name);
         }
@@ -78,7 +110,9 @@ class Schema : public Object {
          *  expectd to be unique, duplicates result in undefined behavior. */
         void add_row(String* name) {
             if (name != nullptr) {
-                exit_if_not(!row_names_->contains(name), "Duplicate row name given.");
+                size_t idx;
+                exit_if_not(!row_index_->get(name, &idx), "Duplicate row name given.");
+                row_index_->put(name, row_names_->size());
             }
             row_names_->append(name);
         }
@@ -105,18 +139,12 @@ class Schema : public Object {
         
         /** Given a column name return its index, or -1. */
         int col_idx(const char* name) {
-            String* s = new String(name);
-            int idx = col_names_->index_of(s);
-            delete s;
-            return idx;
+            return find_name_(col_index_, name);
         }
         
         /** Given a row name return its index, or -1. */
         int row_idx(const char* name) {
-            String* s = new String(name);
-            int idx = row_names_->index_of(s);
-            delete s;
-            return idx;
+            return find_name_(row_index_, name);
         }
         
         /** The number of columns */
@@ -146,6 +174,8 @@ class Schema : public Object {
 
         void clear_row_names() {
             delete row_names_;
+            delete row_index_;
             row_names_ = new Array();
+            row_index_ = new StringMap();
         }
 };
\ No newline at end of file
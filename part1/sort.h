@@ -0,0 +1,256 @@
+//lang::CwC
+
+#pragma once
+
+#include "column.h"
+#include "thread.h"
+#include <algorithm>
+
+// Number of key bits each radix sort pass orders by, and the number of
+// buckets that makes
+#define RADIX_BITS 8
+#define RADIX_BUCKETS 256
+
+/**
+ * Task that computes the 32-bit radix sort key of each row of an int, float,
+ * bool or dictionary encoded string column, in the order given by a
+ * permutation, one storage chunk of positions per unit of work. Keys order
+ * as unsigned ints the way the values do: ints have their sign bit flipped,
+ * floats have their sign bit flipped when positive and every bit flipped
+ * when negative, and the strings of a dictionary encoded column are replaced
+ * by the rank of their dictionary entry.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class SortKeysTask : public ChunkTask {
+    public:
+        // The column, the rows of a view or nullptr, the permutation, and the
+        // keys to fill, all external
+        Column* col_;
+        SizeArray* rows_;
+        uint32_t* perm_;
+        uint32_t* keys_;
+        size_t length_;
+        // For a dictionary encoded column, the rank of each dictionary entry
+        // among the others, external
+        uint32_t* ranks_;
+
+        SortKeysTask(Column* col, SizeArray* rows, uint32_t* perm, uint32_t* keys, uint32_t* ranks,
+                     size_t length, size_t nworkers)
+            : ChunkTask((length + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE, nworkers) {
+            col_ = col;
+            rows_ = rows;
+            perm_ = perm;
+            keys_ = keys;
+            ranks_ = ranks;
+            length_ = length;
+        }
+
+        static uint32_t int_key(int val) {
+            return (uint32_t)val ^ 0x80000000;
+        }
+
+        static uint32_t float_key(float val) {
+            // -0.0 sorts with 0.0
+            if (val == 0) val = 0;
+            uint32_t bits;
+            memcpy(&bits, &val, sizeof(bits));
+            return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+        }
+
+        /** Returns the rank of each dictionary entry of the given dictionary
+         *  encoded column when the entries are sorted by their characters.
+         *  The caller must delete the array. */
+        static uint32_t* dictionary_ranks(StringColumn* col) {
+            size_t n = col->dictionary_size();
+            uint32_t* order = new uint32_t[n];
+            for (size_t e = 0; e < n; e++) {
+                order[e] = e;
+            }
+            std::sort(order, order + n, [col](uint32_t a, uint32_t b) {
+                int sa = col->sizes_->get(a);
+                int sb = col->sizes_->get(b);
+                int cmp = memcmp(col->chars_->at(col->offsets_->get(a)),
+                                 col->chars_->at(col->offsets_->get(b)), sa < sb ? sa : sb);
+                return cmp != 0 ? cmp < 0 : sa < sb;
+            });
+            uint32_t* ranks = new uint32_t[n];
+            for (size_t r = 0; r < n; r++) {
+                ranks[order[r]] = r;
+            }
+            delete[] order;
+            return ranks;
+        }
+
+        size_t row_(size_t i) {
+            return rows_ == nullptr ? perm_[i] : rows_->get(perm_[i]);
+        }
+
+        void run_chunk(size_t k) {
+            size_t start = k << ARRAY_CHUNK_SHIFT;
+            size_t end = length_ - start < ARRAY_CHUNK_SIZE ? length_ : start + ARRAY_CHUNK_SIZE;
+            switch (col_->get_type()) {
+                case 'I': {
+                    IntArray* vals = col_->as_int()->get_fields();
+                    for (size_t i = start; i < end; i++) keys_[i] = int_key(vals->get(row_(i)));
+                    break;
+                }
+                case 'F': {
+                    FloatArray* vals = col_->as_float()->get_fields();
+                    for (size_t i = start; i < end; i++) keys_[i] = float_key(vals->get(row_(i)));
+                    break;
+                }
+                case 'B': {
+                    BoolArray* vals = col_->as_bool()->get_fields();
+                    for (size_t i = start; i < end; i++) keys_[i] = vals->get(row_(i));
+                    break;
+                }
+                case 'S': {
+                    // Missing strings come first
+                    StringColumn* vals = col_->as_string();
+                    for (size_t i = start; i < end; i++) {
+                        int code = vals->get_code(row_(i));
+                        keys_[i] = code < 0 ? 0 : ranks_[code] + 1;
+                    }
+                    break;
+                }
+            }
+        }
+};
+
+/**
+ * Task that runs one of the two steps of a pass of a least significant
+ * digit radix sort over keys and the permutation that goes with them, one
+ * storage chunk of positions per unit of work: counting the keys of each
+ * chunk per bucket of the current digit, or, once the counts have been
+ * turned into positions, moving each key and its row to the output in
+ * order. Chunks keep their rows in order within a bucket, so each pass is
+ * stable.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class RadixPassTask : public ChunkTask {
+    public:
+        // Keys and rows to read, and to write when scattering, external
+        uint32_t* keys_;
+        uint32_t* perm_;
+        uint32_t* keys_out_;
+        uint32_t* perm_out_;
+        // Per chunk, per bucket: the number of keys, then where the next one
+        // goes, external
+        size_t* counts_;
+        size_t shift_;
+        bool scatter_;
+        size_t length_;
+
+        RadixPassTask(uint32_t* keys, uint32_t* perm, uint32_t* keys_out, uint32_t* perm_out,
+                      size_t* counts, size_t shift, bool scatter, size_t length, size_t nworkers)
+            : ChunkTask((length + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE, nworkers) {
+            keys_ = keys;
+            perm_ = perm;
+            keys_out_ = keys_out;
+            perm_out_ = perm_out;
+            counts_ = counts;
+            shift_ = shift;
+            scatter_ = scatter;
+            length_ = length;
+        }
+
+        void run_chunk(size_t k) {
+            size_t start = k << ARRAY_CHUNK_SHIFT;
+            size_t end = length_ - start < ARRAY_CHUNK_SIZE ? length_ : start + ARRAY_CHUNK_SIZE;
+            size_t* counts = &counts_[k * RADIX_BUCKETS];
+            if (scatter_) {
+                for (size_t i = start; i < end; i++) {
+                    size_t pos = counts[(keys_[i] >> shift_) & (RADIX_BUCKETS - 1)]++;
+                    keys_out_[pos] = keys_[i];
+                    perm_out_[pos] = perm_[i];
+                }
+                return;
+            }
+            for (size_t b = 0; b < RADIX_BUCKETS; b++) {
+                counts[b] = 0;
+            }
+            for (size_t i = start; i < end; i++) {
+                counts[(keys_[i] >> shift_) & (RADIX_BUCKETS - 1)]++;
+            }
+        }
+};
+
+/**
+ * Orders rows of a string column by their strings, missing strings first,
+ * comparing bytes as unsigned chars and a prefix before the longer string.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class StringLess {
+    public:
+        // The column and the rows of a view or nullptr, external
+        StringColumn* col_;
+        SizeArray* rows_;
+
+        StringLess(StringColumn* col, SizeArray* rows) {
+            col_ = col;
+            rows_ = rows;
+        }
+
+        bool operator()(uint32_t a, uint32_t b) const {
+            size_t ra = rows_ == nullptr ? a : rows_->get(a);
+            size_t rb = rows_ == nullptr ? b : rows_->get(b);
+            int sa = col_->get_size(ra);
+            int sb = col_->get_size(rb);
+            if (sb < 0) return false;
+            if (sa < 0) return true;
+            int cmp = memcmp(col_->get_chars(ra), col_->get_chars(rb), sa < sb ? sa : sb);
+            return cmp != 0 ? cmp < 0 : sa < sb;
+        }
+};
+
+/**
+ * Task that runs one round of a stable merge sort of a permutation by a
+ * string column: either sorting each run of ARRAY_CHUNK_SIZE positions on
+ * its own, or merging each pair of sorted runs of the given width into the
+ * output, one run or pair per unit of work. Ties keep the order of the
+ * input.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class MergeSortTask : public ChunkTask {
+    public:
+        StringLess less_;
+        // The permutation to sort or merge, and the output of a merge,
+        // external
+        uint32_t* perm_;
+        uint32_t* out_;
+        size_t length_;
+        // Width of the sorted runs to merge, 0 to sort the runs first
+        size_t width_;
+
+        MergeSortTask(StringColumn* col, SizeArray* rows, uint32_t* perm, uint32_t* out,
+                      size_t length, size_t width, size_t nworkers)
+            : ChunkTask(width == 0 ? (length + ARRAY_CHUNK_SIZE - 1) / ARRAY_CHUNK_SIZE
+                                   : (length + 2 * width - 1) / (2 * width), nworkers),
+              less_(col, rows) {
+            perm_ = perm;
+            out_ = out;
+            length_ = length;
+            width_ = width;
+        }
+
+        void run_chunk(size_t u) {
+            if (width_ == 0) {
+                size_t start = u << ARRAY_CHUNK_SHIFT;
+                size_t end = length_ - start < ARRAY_CHUNK_SIZE ? length_ : start + ARRAY_CHUNK_SIZE;
+                std::stable_sort(perm_ + start, perm_ + end, less_);
+                return;
+            }
+            size_t lo = 2 * u * width_;
+            size_t mid = length_ - lo < width_ ? length_ : lo + width_;
+            size_t hi = length_ - mid < width_ ? length_ : mid + width_;
+            std::merge(perm_ + lo, perm_ + mid, perm_ + mid, perm_ + hi, out_ + lo, less_);
+        }
+};
@@ -76,10 +76,14 @@ public:
     }
 
     /** Compute a hash for this string. */
-    size_t hash_me() {
+    size_t hash_me() { return hash_chars(cstr_, size_); }
+
+    /** Compute the hash that a String of the given characters would have,
+     *  without building one. */
+    static size_t hash_chars(const char* chars, size_t len) {
         size_t hash = 0;
-        for (size_t i = 0; i < size_; ++i)
-            hash = cstr_[i] + (hash << 6) + (hash << 16) - hash;
+        for (size_t i = 0; i < len; ++i)
+            hash = chars[i] + (hash << 6) + (hash << 16) - hash;
         return hash;
     }
  };
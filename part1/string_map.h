@@ -0,0 +1,158 @@
+#pragma once
+
+#include "string.h"
+#include <assert.h>
+
+// Number of slots in a new StringMap; it doubles whenever it gets half full
+#define INITIAL_MAP_CAPACITY 16
+
+/**
+ * A hash map from strings to sizes, using open addressing with linear probing.
+ * Keys are given as characters and a length, hashed like String::hash(), and
+ * are not copied: they must stay valid and unchanged while they are in the map.
+ * Lookups allocate nothing and compare characters only when the full hashes
+ * match.
+ *
+ * @author Spencer LaChance <lachance.s@husky.neu.edu>
+ * @author David Mberingabo <mberingabo.d@husky.neu.edu>
+ */
+class StringMap : public Object {
+    public:
+        // Per slot: the key (nullptr for an empty slot), its length and hash,
+        // and the value
+        const char** keys_;
+        size_t* lens_;
+        size_t* hashes_;
+        size_t* values_;
+        // Number of slots, always a power of two
+        size_t capacity_;
+        // Number of keys
+        size_t size_;
+
+        /**
+         * Initialize an empty map.
+         */
+        StringMap() {
+            size_ = 0;
+            alloc_(INITIAL_MAP_CAPACITY);
+        }
+
+        /**
+         * Destructor, the keys are external.
+         */
+        ~StringMap() {
+            free_();
+        }
+
+        /**
+         * Private function that allocates capacity empty slots.
+         */
+        void alloc_(size_t capacity) {
+            capacity_ = capacity;
+            keys_ = new const char*[capacity_];
+            lens_ = new size_t[capacity_];
+            hashes_ = new size_t[capacity_];
+            values_ = new size_t[capacity_];
+            for (size_t i = 0; i < capacity_; i++) {
+                keys_[i] = nullptr;
+            }
+        }
+
+        /**
+         * Private function that frees the slots.
+         */
+        void free_() {
+            delete[] keys_;
+            delete[] lens_;
+            delete[] hashes_;
+            delete[] values_;
+        }
+
+        /**
+         * Private function that returns the slot holding the given key, or the
+         * empty slot where it would go.
+         */
+        size_t find_(const char* chars, size_t len, size_t hash) {
+            size_t mask = capacity_ - 1;
+            size_t slot = hash & mask;
+            while (keys_[slot] != nullptr) {
+                if (hashes_[slot] == hash && lens_[slot] == len &&
+                    memcmp(keys_[slot], chars, len) == 0) {
+                    return slot;
+                }
+                slot = (slot + 1) & mask;
+            }
+            return slot;
+        }
+
+        /**
+         * Private function that doubles the number of slots and reinserts
+         * every key.
+         */
+        void grow_() {
+            const char** keys = keys_;
+            size_t* lens = lens_;
+            size_t* hashes = hashes_;
+            size_t* values = values_;
+            size_t capacity = capacity_;
+            alloc_(capacity * 2);
+            for (size_t i = 0; i < capacity; i++) {
+                if (keys[i] == nullptr) continue;
+                size_t slot = find_(keys[i], lens[i], hashes[i]);
+                keys_[slot] = keys[i];
+                lens_[slot] = lens[i];
+                hashes_[slot] = hashes[i];
+                values_[slot] = values[i];
+            }
+            delete[] keys;
+            delete[] lens;
+            delete[] hashes;
+            delete[] values;
+        }
+
+        // Looks up the given key. If it is present, stores its value in
+        // value and returns true.
+        bool get(const char* chars, size_t len, size_t* value) {
+            size_t slot = find_(chars, len, String::hash_chars(chars, len));
+            if (keys_[slot] == nullptr) return false;
+            *value = values_[slot];
+            return true;
+        }
+
+        // Looks up the given String.
+        bool get(String* key, size_t* value) {
+            size_t slot = find_(key->c_str(), key->size(), key->hash());
+            if (keys_[slot] == nullptr) return false;
+            *value = values_[slot];
+            return true;
+        }
+
+        // Maps the given key to the given value, replacing any previous value.
+        void put(const char* chars, size_t len, size_t value) {
+            assert(chars != nullptr);
+            size_t hash = String::hash_chars(chars, len);
+            size_t slot = find_(chars, len, hash);
+            if (keys_[slot] == nullptr) {
+                if (2 * (size_ + 1) > capacity_) {
+                    grow_();
+                    slot = find_(chars, len, hash);
+                }
+                keys_[slot] = chars;
+                lens_[slot] = len;
+                hashes_[slot] = hash;
+                size_++;
+            }
+            values_[slot] = value;
+        }
+
+        // Maps the given String, whose characters are used as the key, to the
+        // given value.
+        void put(String* key, size_t value) {
+            put(key->c_str(), key->size(), value);
+        }
+
+        // Returns the number of keys.
+        size_t size() {
+            return size_;
+        }
+};
@@ -6,7 +6,7 @@
 #include <condition_variable>
 #include <sstream>
 #include "object.h"
-#include "../string.h"
+#include "string.h"
 #include <assert.h>
 #include <atomic>
 
@@ -91,3 +91,173 @@ public:
 
     size_t current() { return next_;  }
 };
+
+
+/** A unit of work that a ThreadPool hands to each of its workers.
+ *  Subclasses implement run_task(), which is called concurrently once per
+ *  worker with that worker's index. */
+class Task : public Object {
+public:
+    /** Subclass responsibility, the body of the task for the given worker */
+    virtual void run_task(size_t worker) = 0;
+};
+
+class ThreadPool;
+
+/** A Thread owned by a ThreadPool that sleeps until the pool has work. */
+class PoolThread : public Thread {
+public:
+    ThreadPool* pool_;
+    size_t idx_;
+
+    PoolThread(ThreadPool* pool, size_t idx) {
+        pool_ = pool;
+        idx_ = idx;
+    }
+
+    void run();
+};
+
+/** A fixed set of persistent worker threads. Each call to run() hands the
+ *  same Task to every worker and blocks until all of them have finished, so
+ *  the threads are created once and reused across calls. */
+class ThreadPool : public Object {
+public:
+    Lock lock_;
+    PoolThread** threads_;
+    size_t nthreads_;
+    // The task being run and the number of workers still running it
+    Task* task_;
+    size_t pending_;
+    // Bumped for every task so that sleeping workers can tell new work apart
+    size_t generation_;
+    bool shutdown_;
+
+    /** Starts nthreads worker threads (at least one). */
+    ThreadPool(size_t nthreads) {
+        nthreads_ = nthreads == 0 ? 1 : nthreads;
+        task_ = nullptr;
+        pending_ = 0;
+        generation_ = 0;
+        shutdown_ = false;
+        threads_ = new PoolThread*[nthreads_];
+        for (size_t i = 0; i < nthreads_; i++) {
+            threads_[i] = new PoolThread(this, i);
+            threads_[i]->start();
+        }
+    }
+
+    /** Stops and joins every worker. */
+    ~ThreadPool() {
+        lock_.lock();
+        shutdown_ = true;
+        lock_.notify_all();
+        lock_.unlock();
+        for (size_t i = 0; i < nthreads_; i++) {
+            threads_[i]->join();
+            delete threads_[i];
+        }
+        delete[] threads_;
+    }
+
+    /** The number of worker threads in this pool. */
+    size_t size() { return nthreads_; }
+
+    /** Runs the task on every worker and waits for all of them to finish.
+     *  The task is external. */
+    void run(Task* task) {
+        lock_.lock();
+        task_ = task;
+        pending_ = nthreads_;
+        generation_++;
+        lock_.notify_all();
+        while (pending_ > 0) lock_.wait();
+        task_ = nullptr;
+        lock_.unlock();
+    }
+
+    /** The loop executed by each worker thread. */
+    void work(size_t idx) {
+        size_t seen = 0;
+        while (true) {
+            lock_.lock();
+            while (generation_ == seen && !shutdown_) lock_.wait();
+            if (shutdown_) {
+                lock_.unlock();
+                return;
+            }
+            seen = generation_;
+            Task* task = task_;
+            lock_.unlock();
+
+            task->run_task(idx);
+
+            lock_.lock();
+            pending_--;
+            if (pending_ == 0) lock_.notify_all();
+            lock_.unlock();
+        }
+    }
+
+    /** The number of workers to use by default: one per hardware thread. */
+    static size_t default_size() {
+        size_t n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+};
+
+inline void PoolThread::run() { pool_->work(idx_); }
+
+/** A Task split into nchunks independent chunks. Every worker starts on its
+ *  own contiguous range of chunks, claiming them one at a time from an atomic
+ *  cursor, and once its range is exhausted it steals unclaimed chunks from the
+ *  other workers' cursors. Each chunk is run exactly once. */
+class ChunkTask : public Task {
+public:
+    size_t nchunks_;
+    size_t nworkers_;
+    // Per worker: the next chunk to claim from its range, and the range end
+    Counter* cursors_;
+    size_t* ends_;
+
+    ChunkTask(size_t nchunks, size_t nworkers) {
+        nchunks_ = nchunks;
+        nworkers_ = nworkers == 0 ? 1 : nworkers;
+        cursors_ = new Counter[nworkers_];
+        ends_ = new size_t[nworkers_];
+        for (size_t w = 0; w < nworkers_; w++) {
+            cursors_[w].next_ = nchunks_ * w / nworkers_;
+            ends_[w] = nchunks_ * (w + 1) / nworkers_;
+        }
+    }
+
+    ~ChunkTask() {
+        delete[] cursors_;
+        delete[] ends_;
+    }
+
+    /** Subclass responsibility, processes a single chunk. Terminates unless
+     *  overridden, since a task that overrides the worker version below
+     *  never calls it. */
+    virtual void run_chunk(size_t) {
+        exit_if_not(false, "ChunkTask must override run_chunk.");
+    }
+
+    /** Processes a single chunk on the given worker. Tasks that keep state
+     *  per worker override this instead of run_chunk(). */
+    virtual void run_chunk(size_t chunk, size_t) { run_chunk(chunk); }
+
+    /** Drains this worker's own range, then steals from the others. A
+     *  worker past the task's own number has nothing to do, so that a pool
+     *  with more threads than the task needs can still run it. */
+    void run_task(size_t worker) {
+        if (worker >= nworkers_) return;
+        for (size_t i = 0; i < nworkers_; i++) {
+            size_t victim = (worker + i) % nworkers_;
+            size_t chunk;
+            while ((chunk = cursors_[victim].next()) < ends_[victim]) {
+                run_chunk(chunk, worker);
+            }
+        }
+    }
+};
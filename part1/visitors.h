@@ -6,6 +6,8 @@
 #include "string.h"
 
 class Row;
+class RowView;
+class RowBlock;
 
 /*****************************************************************************
  * Fielder::
@@ -41,6 +43,18 @@ class Rower : public Object {
       call. The return value is used in filters to indicate that a row
       should be kept. */
   virtual bool accept(Row& r) = 0;
+
+  /** Called once per row by DataFrame::map() and pmap() with a view that reads
+      straight from the data frame's columns. The default implementation copies
+      the fields into a Row and calls accept(Row&); Rowers override this to
+      skip that copy. The view is on loan just like the Row. */
+  virtual bool accept(RowView& r);
+
+  /** Called by DataFrame::map() and pmap() with a block of consecutive rows,
+      whose columns can be read as plain typed arrays. The default
+      implementation calls accept(RowView&) on each row of the block in order;
+      Rowers override this to process whole columns at a time. */
+  virtual void accept(RowBlock& b);
  
   /** Once traversal of the data frame is complete the rowers that were
       split off will be joined.  There will be one join per split. The